@@ -11,28 +11,42 @@
 
 #include "shader_s.h"
 #include "camera.h"
+#include "gl_state.h"
+#include "model.h"
+#include "food_batch.h"
+#include "bounds.h"
+#include "frustum.h"
+#include "headless.h"
+#include "options.h"
+#include "stats.h"
+#include "alloc_tracker.h"
+#include "frame_arena.h"
+#include "telemetry_analysis.h"
+#include "logging.h"
+#include "gpu_profiler.h"
+#include "sim_thread.h"
+#include "soak.h"
+#include "bench.h"
+#include "tunneling.h"
+#include "balance.h"
+#include "controllers.h"
+#include "input_recording.h"
+#include "job_system.h"
+#include "audio.h"
+#include "voice_pool.h"
+#include "mixer.h"
+#include "profiler.h"
 
 #include <iostream>
 #include <map>
+#include <chrono>
+#include <memory>
+#include <cstring>
 
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
-#include <irrKlang.h>
-using namespace irrklang;
-
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
-// Collision handling
-	// AABB (Axis-Aligned Bounding Box) structure
-struct AABB {
-	glm::vec3 min;  // Minimum corner (x, y, z)
-	glm::vec3 max;  // Maximum corner (x, y, z)
-};
-
 struct Character {
 	unsigned int TextureID; // ID handle of the glyph texture
 	glm::ivec2 Size; // Size of glyph
@@ -40,19 +54,20 @@ struct Character {
 	unsigned int Advance; // Horizontal offset to advance to next glyph
 };
 
-struct Food {
-	glm::vec3 position;
-	int type;
-};
-
-std::vector<Food> foods;
-
 std::map<char, Character> Characters;
 unsigned int txtVAO, txtVBO;
+// frame-time graphs of the debug overlay
+const unsigned int GRAPH_FRAMES = 240;
+unsigned int graphVAO, graphVBO, graphTexture;
+// --alloc-report counts from here on, once pools, caches and the driver have filled up
+const unsigned int ALLOC_WARMUP_FRAMES = 120;
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+const unsigned int AUDIO_VOICES = 8; // sounds playing at once
+const unsigned int AUDIO_RATE = 44100;
+const unsigned int AUDIO_BUFFER_FRAMES = 512; // 11.6 ms per mixer buffer
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -60,6 +75,9 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// debug overlay, toggled with F3
+bool showDebugOverlay = false;
+
 // timing
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
@@ -78,247 +96,122 @@ float plateVerteces[] = {
 	-0.15f, -0.10f, 0.01f,  0.0f, 0.0f,  // bottom left
 	-0.15f, 0.10f, 0.01f,   0.0f, 1.0f   // top left
 };
-glm::vec3 platePosition = { 0.0f, -1.10f, 0.0f };
-
-ISoundEngine* soundEngine = createIrrKlangDevice();
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
-glm::vec3 generateRandomPosition();
-AABB createAABB(const glm::vec3& position);
-bool checkCollision(const AABB& a, const AABB& b);
-void renderText(Shader& s, std::string text, float x, float y, float scale, glm::vec3 color);
-unsigned int TextureFromFile(const char* path, const std::string& directory);
-int generateRandomObject();
-
-// Struct for Vertex
-struct Vertex {
-	glm::vec3 Position;
-	glm::vec3 Normal;
-	glm::vec2 TexCoords;
-};
-
-// Struct for Texture
-struct Texture {
-	unsigned int id;
-	std::string type;
-	std::string path;
-};
-
-// Mesh class
-class Mesh {
-public:
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
-	unsigned int VAO;
-
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures) {
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
-		setupMesh();
-	}
+void processInput(GLFWwindow* window, GameInput& input);
+void renderText(Shader& s, const char* text, float x, float y, float scale, glm::vec3 color);
+void renderGraph(Shader& s, const float* values, unsigned int count, float x, float y, float width, float height, float maxValue, glm::vec3 color);
 
-	void Draw(Shader& shader) {
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		for (unsigned int i = 0; i < textures.size(); i++) {
-			glActiveTexture(GL_TEXTURE0 + i);
-			std::string number;
-			std::string name = textures[i].type;
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++);
-			shader.setInt(("material." + name + number).c_str(), i);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
-		}
-		glActiveTexture(GL_TEXTURE0);
-
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-	}
-
-private:
-	unsigned int VBO, EBO;
-
-	void setupMesh() {
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-
-		glBindVertexArray(VAO);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-
-		glBindVertexArray(0);
-	}
-};
-
-// Model class
-class Model {
-public:
-	Model(const std::string& path) { loadModel(path); }
-
-	void Draw(Shader& shader) {
-		for (unsigned int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shader);
-	}
-
-private:
-	std::vector<Mesh> meshes;
-	std::string directory;
-
-	void loadModel(const std::string& path) {
-		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals);
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-			std::cerr << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-			return;
-		}
-		directory = path.substr(0, path.find_last_of('/'));
-		processNode(scene->mRootNode, scene);
-	}
-
-	void processNode(aiNode* node, const aiScene* scene) {
-		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
-		}
-		for (unsigned int i = 0; i < node->mNumChildren; i++) {
-			processNode(node->mChildren[i], scene);
-		}
-	}
-
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
-		std::vector<Vertex> vertices;
-		std::vector<unsigned int> indices;
-		std::vector<Texture> textures;
-
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			Vertex vertex;
-			glm::vec3 vector;
-			vector.x = mesh->mVertices[i].x;
-			vector.y = mesh->mVertices[i].y;
-			vector.z = mesh->mVertices[i].z;
-			vertex.Position = vector;
-
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-			vertex.Normal = vector;
-
-			if (mesh->mTextureCoords[0]) {
-				glm::vec2 vec;
-				vec.x = mesh->mTextureCoords[0][i].x;
-				vec.y = mesh->mTextureCoords[0][i].y;
-				vertex.TexCoords = vec;
-			}
-			else
-				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-			vertices.push_back(vertex);
-		}
-
-		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-			aiFace face = mesh->mFaces[i];
-			for (unsigned int j = 0; j < face.mNumIndices; j++)
-				indices.push_back(face.mIndices[j]);
-		}
-
-		if (mesh->mMaterialIndex >= 0) {
-			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-			std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-			textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-			std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		}
-
-		return Mesh(vertices, indices, textures);
-	}
-
-	std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName) {
-		std::vector<Texture> textures;
-		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
-			aiString str;
-			mat->GetTexture(type, i, &str);
-			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), directory);
-			texture.type = typeName;
-			texture.path = str.C_Str();
-			textures.push_back(texture);
+int main(int argc, char** argv)
+{
+	AppOptions options;
+	if (!parseOptions(argc, argv, options))
+		return -1;
+	// the log writer thread, flushed on every way out of main
+	LogSession logSession(options.logPath);
+	if (options.soakMinutes > 0)
+		return runSoak(options.soakMinutes, options.tickRate);
+	if (options.benchSoa)
+		return runSoaBench();
+	if (options.benchBatch > 0)
+		return runBatchBench(options.benchBatch);
+	if (options.benchJobs)
+		return runJobBench();
+	if (options.benchAudio)
+		return runAudioBench();
+	if (options.checkTunneling)
+		return runTunnelingCheck();
+	if (options.balanceLevels > 0)
+		return runBalance(options);
+	if (!options.analyzePath.empty())
+		return runTelemetryAnalysis(options.analyzePath, options.baselinePath);
+
+	// --trace: every PROFILE_SCOPE from here on ends up in a Chrome trace written at exit
+	if (!options.tracePath.empty())
+		profiler().start();
+	PROFILE_THREAD("main");
+	PROFILE_STAGES(startup);
+	PROFILE_STAGE(startup, "startup.context");
+
+	GLFWwindow* window = NULL;
+	HeadlessContext headless;
+	OffscreenTarget offscreen;
+	float viewAspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+
+	if (options.headless) {
+		// surfaceless EGL context, everything is drawn into an FBO
+		// --------------------------------------------------------
+		if (!headless.create(3, 3))
+			return -1;
+		if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+		{
+			LOG_ERROR(GL, "Failed to initialize GLAD");
+			return -1;
 		}
-		return textures;
+		if (!offscreen.create(options.width, options.height))
+			return -1;
+		viewAspect = (float)options.width / (float)options.height;
 	}
-};
-
-int main()
-{
-	// glfw: initialize and configure
-	// ------------------------------
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	else {
+		// glfw: initialize and configure
+		// ------------------------------
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-	// glfw window creation
-	// --------------------
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Collect it!", NULL, NULL);
-	if (window == NULL)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	// glfwSetCursorPosCallback(window, mouse_callback); // for moving the view with the mouse
-	glfwSetScrollCallback(window, scroll_callback);
+		// glfw window creation
+		// --------------------
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Collect it!", NULL, NULL);
+		if (window == NULL)
+		{
+			LOG_ERROR(GL, "Failed to create GLFW window");
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		// glfwSetCursorPosCallback(window, mouse_callback); // for moving the view with the mouse
+		glfwSetScrollCallback(window, scroll_callback);
 
-	// tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		// tell GLFW to capture our mouse
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-	// glad: load all OpenGL function pointers
-	// ---------------------------------------
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
+		// glad: load all OpenGL function pointers
+		// ---------------------------------------
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			LOG_ERROR(GL, "Failed to initialize GLAD");
+			return -1;
+		}
 	}
 
 	// configure global opengl state
 	// -----------------------------
-	glEnable(GL_DEPTH_TEST);
+	glState().invalidate();
+	glState().enable(GL_DEPTH_TEST);
 
 	// build and compile our shader zprogram
+	PROFILE_STAGE(startup, "startup.shaders");
 	// ------------------------------------
 	Shader ourShader("shader.vs", "shader.fs");
 
-	Model croissantModel("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/croissant.obj");
+	// the food models share one buffer so the whole food pass is a single multi-draw
+	PROFILE_STAGE(startup, "startup.models");
+	MeshBuffer foodMeshes;
+	Model croissantModel("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/croissant.obj", &foodMeshes);
 	Model plateModel("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/sgorbio.obj");
-	Model otherModel("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/togocup.obj");
-	Model muffinModel("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/gus2.obj"); //con muffin.obj crasha
+	Model otherModel("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/togocup.obj", &foodMeshes);
+	Model muffinModel("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/gus2.obj", &foodMeshes); //con muffin.obj crasha
 
 	// Text handling
+	PROFILE_STAGE(startup, "startup.font");
 	// --------------------------------------
 
 	// compile and setup the shader
@@ -328,23 +221,15 @@ int main()
 	shader.use();
 	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-	shader.use();
-	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
 	FT_Library ft;
 	if (FT_Init_FreeType(&ft)) {
-		std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+		LOG_ERROR(FREETYPE, "Could not init FreeType Library");
 		return -1;
 	}
 	std::string font_name = "resources/fonts/Antonio/static/Antonio-Bold.ttf";
 	FT_Face face;
 	if (FT_New_Face(ft, font_name.c_str(), 0, &face)) {
-		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
-		return -1;
-	}
-
-	if (!soundEngine) {
-		std::cerr << "Could not initialize irrKlang sound engine" << std::endl;
+		LOG_ERROR(FREETYPE, "Failed to load font");
 		return -1;
 	}
 
@@ -352,7 +237,7 @@ int main()
 
 	if (FT_Load_Char(face, 'X', FT_LOAD_RENDER))
 	{
-		std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+		LOG_ERROR(FREETYPE, "Failed to load Glyph");
 		return -1;
 	}
 
@@ -363,13 +248,13 @@ int main()
 		// load character glyph 
 		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
 		{
-			std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+			LOG_ERROR(FREETYPE, "Failed to load Glyph");
 			continue;
 		}
 		// generate texture
 		unsigned int texture;
 		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
+		glState().bindTexture(0, texture);
 		glTexImage2D(
 			GL_TEXTURE_2D,
 			0,
@@ -403,16 +288,30 @@ int main()
 // -----------------------------------
 	glGenVertexArrays(1, &txtVAO);
 	glGenBuffers(1, &txtVBO);
-	glBindVertexArray(txtVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, txtVBO);
+	glState().bindVertexArray(txtVAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, txtVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+
+	// graph bars are text quads too, over a single white texel
+	glGenVertexArrays(1, &graphVAO);
+	glGenBuffers(1, &graphVBO);
+	glState().bindVertexArray(graphVAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, graphVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4 * GRAPH_FRAMES, NULL, GL_DYNAMIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+	unsigned char white = 255;
+	glGenTextures(1, &graphTexture);
+	glState().bindTexture(0, graphTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 1, 1, 0, GL_RED, GL_UNSIGNED_BYTE, &white);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
 	//----------- END text handling
 
+	PROFILE_STAGE(startup, "startup.geometry");
 	float conveyorBeltVertices[] = {
 		// first triangle
 		0.60f, 1.20f, -0.01f,    1.0f, 1.0f,  // top right
@@ -424,13 +323,6 @@ int main()
 		-0.60f, -1.20f, -0.01f,  0.0f, 0.0f,  // bottom left
 		-0.60f, 1.20f, -0.01f,   0.0f, 1.0f   // top left
 	};
-	glm::vec3 conveyorBeltPositions[] = {
-	glm::vec3(0.0f, 0.0f, 0.0f),
-	glm::vec3(0.0f, 2.4f, 0.0f)
-	};
-
-	float conveyorSpeed = 0.002f; // Speed of scrolling
-
 	// set up vertex data (and buffer(s)) and configure vertex attributes
 	// ------------------------------------------------------------------
 	float objectsVertices[] = {
@@ -449,20 +341,15 @@ int main()
 	std::vector<glm::vec3> objectsPositions; //OBSOLETE
 	objectsPositions.push_back(generateRandomPosition());
 
-	Food food;
-	food.position = generateRandomPosition();
-	food.type = generateRandomObject();
-	foods.push_back(food);
-
 	// Declare VAO and VBO for the conveyor belt
 	unsigned int conveyorVAO, conveyorVBO;
 	glGenVertexArrays(1, &conveyorVAO);
 	glGenBuffers(1, &conveyorVBO);
 
 	// Bind and set the conveyor belt vertices
-	glBindVertexArray(conveyorVAO);
+	glState().bindVertexArray(conveyorVAO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, conveyorVBO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, conveyorVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(conveyorBeltVertices), conveyorBeltVertices, GL_STATIC_DRAW);
 
 	// Position attribute
@@ -473,8 +360,6 @@ int main()
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
 
-	glBindVertexArray(0); // Unbind VAO
-
 
 	// PLATE
 	// --------------------------------------------------------------------------------------------------
@@ -483,9 +368,9 @@ int main()
 	glGenVertexArrays(1, &plateVAO);
 	glGenBuffers(1, &plateVBO);
 
-	glBindVertexArray(plateVAO);
+	glState().bindVertexArray(plateVAO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, plateVBO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, plateVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(plateVerteces), plateVerteces, GL_STATIC_DRAW);
 
 	// Position attribute
@@ -496,36 +381,62 @@ int main()
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
 
-	glBindVertexArray(0); // Unbind VAO
-
 
 
 	// CUBES
 	// --------------------------------------------------------------------------------------------------
-	unsigned int VBO, VAO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-
-	glBindVertexArray(VAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(objectsVertices), objectsVertices, GL_STATIC_DRAW);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// texture coord attribute
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	// the quad drawn under every food goes into the shared food buffer as one more mesh
+	std::vector<Vertex> quadVertices;
+	std::vector<unsigned int> quadIndices;
+	for (unsigned int i = 0; i < 6; i++) {
+		Vertex vertex;
+		vertex.Position = glm::vec3(objectsVertices[i * 5], objectsVertices[i * 5 + 1], objectsVertices[i * 5 + 2]);
+		vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+		vertex.TexCoords = glm::vec2(objectsVertices[i * 5 + 3], objectsVertices[i * 5 + 4]);
+		quadVertices.push_back(vertex);
+		quadIndices.push_back(i);
+	}
+	Mesh foodQuad(quadVertices, quadIndices, std::vector<Texture>(), &foodMeshes);
+	foodMeshes.upload();
+
+	// meshes submitted for each food type, indexed by Food::type
+	std::vector<std::vector<MeshRange> > foodTypeMeshes(3);
+	Model* foodModels[3] = { &croissantModel, &otherModel, &muffinModel };
+	for (int t = 0; t < 3; t++) {
+		for (unsigned int m = 0; m < foodModels[t]->meshes.size(); m++)
+			foodTypeMeshes[t].push_back(foodModels[t]->meshes[m].range);
+		foodTypeMeshes[t].push_back(foodQuad.range);
+	}
+	FoodBatch foodBatch;
+	foodBatch.init(foodMeshes, foodTypeMeshes);
+	glm::vec3 foodScales[3] = { glm::vec3(0.3f, 0.3f, 0.3f), glm::vec3(0.1f, 0.1f, 0.1f), glm::vec3(0.1f, 0.1f, 0.1f) };
+	const glm::vec3 plateScale(0.15f, 0.15f, 0.15f);
+
+	// local bounds of everything drawn for a food type (model + quad), used for culling
+	AABB foodTypeBounds[3];
+	BoundingSphere foodTypeSpheres[3];
+	for (int t = 0; t < 3; t++) {
+		foodTypeBounds[t] = foodModels[t]->meshes.empty() ? foodQuad.bounds : foodModels[t]->bounds;
+		expand(foodTypeBounds[t], foodQuad.bounds);
+		glm::vec3 center = (foodTypeBounds[t].min + foodTypeBounds[t].max) * 0.5f;
+		float radius = glm::length(foodQuad.sphere.center - center) + foodQuad.sphere.radius;
+		if (!foodModels[t]->meshes.empty())
+			radius = std::fmax(radius, glm::length(foodModels[t]->sphere.center - center) + foodModels[t]->sphere.radius);
+		foodTypeSpheres[t] = BoundingSphere{ center, radius };
+	}
+	SphereBatch foodSpheres;
+	int visibleFoods = 0;
+	int culledFoods = 0;
 
 	// load and create a texture 
+	PROFILE_STAGE(startup, "startup.textures");
 	// -------------------------
 	unsigned int texture1, texture2, texture3;
 
 	// texture 1
 	// ---------
 	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
+	glState().bindTexture(0, texture1);
 	// set the texture wrapping parameters
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -543,14 +454,14 @@ int main()
 	}
 	else
 	{
-		std::cout << "Failed to load texture" << std::endl;
+		LOG_ERROR(TEXTURE, "Failed to load texture");
 	}
 	stbi_image_free(data);
 
 	// texture 2
 	// ---------
 	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
+	glState().bindTexture(0, texture2);
 	// set the texture wrapping parameters
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -567,14 +478,14 @@ int main()
 	}
 	else
 	{
-		std::cout << "Failed to load texture" << std::endl;
+		LOG_ERROR(TEXTURE, "Failed to load texture");
 	}
 	stbi_image_free(data);
 
 	// texture 3
 	// ---------
 	glGenTextures(1, &texture3);
-	glBindTexture(GL_TEXTURE_2D, texture3);
+	glState().bindTexture(0, texture3);
 	// set the texture wrapping parameters
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -590,7 +501,7 @@ int main()
 	}
 	else
 	{
-		std::cout << "Failed to load texture" << std::endl;
+		LOG_ERROR(TEXTURE, "Failed to load texture");
 	}
 	stbi_image_free(data);
 
@@ -601,6 +512,24 @@ int main()
 	ourShader.setInt("texture2", 1);
 	ourShader.setInt("texture3", 2);
 
+	// the instanced food shader shares shader.fs; its lighting never changes so set it once
+	PROFILE_STAGE(startup, "startup.materials");
+	Shader foodShader("shader_instanced.vs", "shader.fs");
+	foodShader.use();
+	foodShader.setInt("texture1", 0);
+	foodShader.setInt("texture2", 1);
+	foodShader.setInt("texture3", 2);
+	foodShader.setInt("textureID", 1);
+	foodShader.setVec3("light.position", lightPos);
+	foodShader.setVec3("viewPos", camera.Position);
+	foodShader.setVec3("light.ambient", glm::vec3(0.4f));
+	foodShader.setVec3("light.diffuse", glm::vec3(0.8f));
+	foodShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+	foodShader.setVec3("material.ambient", 1.0f, 0.5f, 0.31f);
+	foodShader.setVec3("material.diffuse", 1.0f, 0.5f, 0.31f);
+	foodShader.setVec3("material.specular", 0.5f, 0.5f, 0.5f);
+	foodShader.setFloat("material.shininess", 32.0f);
+
 	//----------- BEGIN lightning stuff
 	Shader lightingShader("shader_light.vs", "shader_light.fs");
 
@@ -641,20 +570,16 @@ int main()
 	glGenBuffers(1, &lightVBO);
 
 	// Bind the VAO
-	glBindVertexArray(lightVAO);
+	glState().bindVertexArray(lightVAO);
 
 	// Bind the VBO and load data
-	glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, lightVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(lightVertices), lightVertices, GL_STATIC_DRAW);
 
 	// Define the vertex position attribute
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
 
-	// Unbind the VAO and VBO
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
 	// Set light properties
 	lightingShader.use();
 	lightingShader.setVec3("light.position", lightPos);
@@ -670,166 +595,302 @@ int main()
 
 	//float activationTime[] = { 0.0f, 2.0f, 4.0f, 6.0f, 8.0f, 10.0f, 12.0f, 14.0f, 16.0f, 18.0f, 20.0f, 22.0f, 24.0f, 26.0f, 28.0f, 30.0f, 32.0f, 34.0f, 36.0f, 38.0f, 40.0f }; // Base activation time
 
-	int numberOfCollisions = 0;
-	int numberOfObject = 1;
-
-	float pastTime = 0.0f;
-	float delay = 2.0f;
-	float cubeSpeed = 0.007f;
-	float increaseDifficulty = 6.0f;
-	float pastDifficulty = 0.0f;
-	int level = 1;
+	// a replay brings its own seed and tick rate; otherwise --seed, or a fresh one that a recording keeps
+	PROFILE_STAGE(startup, "startup.simulation");
+	InputRecording replay, recording;
+	if (!options.replayPath.empty()) {
+		if (!replay.load(options.replayPath))
+			return -1;
+		options.seed = replay.seed;
+		options.tickRate = (int)replay.tickRate;
+		// headless: just enough 1/60 s frames to play every recorded tick
+		options.frames = (int)((replay.ticks() * 60 + replay.tickRate - 1) / replay.tickRate) + 1;
+		std::cout << "Replaying " << replay.ticks() << " ticks at " << replay.tickRate << " Hz, seed " << replay.seed << std::endl;
+	}
+	else if (!options.hasSeed) {
+		options.seed = std::random_device()();
+	}
+	recording.seed = options.seed;
+	recording.tickRate = options.tickRate;
+	// replays run lockstep like headless runs, so every frame shows the same state every time
+	bool lockstep = options.headless || !options.replayPath.empty();
+
+	// the game advances in fixed ticks on its own thread; frames render whatever lies between the last two
+	SimThread sim(options.seed);
+	// worker threads for the render thread's per-food loops
+	JobSystem jobs;
+	if (!options.replayPath.empty())
+		sim.replay = &replay;
+	if (!options.recordPath.empty())
+		sim.recording = &recording;
+
+	PROFILE_STAGE(startup, "startup.audio");
+	// sounds are decoded once and played on the audio thread, posted there straight from the
+	// sim thread. The mixer plays them to the sound device, or to a file with --audio-out;
+	// headless runs, --audio-log and machines without a device get the null backend.
+	SoundBank sounds;
+	loadGameSounds(sounds);
+	Mixer mixer(AUDIO_RATE, AUDIO_VOICES);
+	MusicStream music;
+	if (!options.musicPath.empty() && music.open(options.musicPath, mixer.sampleRate())) {
+		music.start();
+		mixer.music = &music;
+	}
+	std::unique_ptr<AudioOutput> audioOutput;
+	if (!options.audioOutPath.empty())
+		audioOutput.reset(new WavFileOutput(options.audioOutPath, true));
+	else if (!options.headless && options.audioLogPath.empty())
+		audioOutput.reset(createDeviceOutput());
+	std::unique_ptr<MixerThread> mixerThread;
+	if (audioOutput) {
+		mixerThread.reset(new MixerThread(mixer, *audioOutput, AUDIO_BUFFER_FRAMES));
+		if (!mixerThread->start()) {
+			std::cout << "Could not open the sound device, playing without sound" << std::endl;
+			mixerThread.reset();
+		}
+	}
+	NullAudioBackend nullAudio;
+	if (!options.audioLogPath.empty())
+		nullAudio.openLog(options.audioLogPath);
+	AudioBackend* audioBackend = mixerThread ? (AudioBackend*)&mixer : &nullAudio;
+	for (unsigned short id = 0; id < SOUND_COUNT; id++) {
+		if (sounds.loaded(id))
+			audioBackend->upload(id, sounds.clip(id));
+	}
+	VoicePool voices(*audioBackend, sounds, AUDIO_VOICES);
+	AudioThread audio;
+	audio.start([&voices](const SoundEvent& event) { voices.play(event); });
+	sim.audio = &audio;
+	GameInput input;
+	lastFrame = options.headless ? 0.0f : static_cast<float>(glfwGetTime());
+	int lastCollisions = sim.game.numberOfCollisions;
+	int lastObjects = sim.game.numberOfObject;
+
+	// rewritten in place when the counts change, so the frame never builds a string
+	char collisionMessage[64];
+	char objectMessage[64];
+	snprintf(collisionMessage, sizeof(collisionMessage), "Object collected: %d", lastCollisions);
+	snprintf(objectMessage, sizeof(objectMessage), "Object dropped: %d", lastObjects);
+
+	PROFILE_STAGE(startup, "startup.collision");
+	// collide with the shapes of the loaded models; one that failed to load keeps the old fixed box
+	CollisionShape foodShapes[3];
+	for (int t = 0; t < 3; t++) {
+		if (!foodModels[t]->meshes.empty())
+			foodShapes[t] = CollisionShape(foodModels[t]->bounds, foodModels[t]->hull, foodScales[t]);
+	}
+	CollisionShape plateShape;
+	if (!plateModel.meshes.empty())
+		plateShape = CollisionShape(plateModel.bounds, plateModel.hull, plateScale);
+	sim.game.setShapes(foodShapes, plateShape);
+	sim.game.narrowphase = options.gjk;
+
+	sim.start(1.0 / options.tickRate, lockstep);
+	if (lockstep)
+		sim.request(1.0 / 60.0, input);
+
+	GpuProfiler gpuProfiler;
+	gpuProfiler.init();
+
+	// headless runs advance a fixed 1/60 s per frame and time every frame on both sides
+	int frame = 0;
+	std::vector<double> cpuFrameMs;
+	std::vector<unsigned int> gpuQueries;
+	unsigned long long frameAllocations = allocationCount();
+	unsigned long long frameBytes = allocatedBytes();
+	unsigned long long frameRenderAllocations = threadAllocationCount();
+	AllocSnapshot allocStart, allocEnd;
+	unsigned int allocFrames = 0;
+	float graphMs[GRAPH_FRAMES];
+	// --telemetry: one record per frame, written by a thread of its own
+	TelemetryWriter telemetry;
+	if (!options.telemetryPath.empty())
+		telemetry.open(options.telemetryPath);
+	std::chrono::steady_clock::time_point telemetryStart = std::chrono::steady_clock::now();
+	unsigned int telemetryFrame = 0;
+	if (options.headless) {
+		cpuFrameMs.reserve(options.frames);
+		gpuQueries.resize(options.frames);
+		glGenQueries(options.frames, gpuQueries.data());
+	}
 
-	std::string collisionMessage = "Object collected: " + std::to_string(numberOfCollisions);
-	std::string objectMessage = "Object dropped: " + std::to_string(numberOfObject);
+	PROFILE_STAGES_END(startup);
 
 	// render loop
 	// -----------
-	while (!glfwWindowShouldClose(window))
+	while (options.headless ? frame < options.frames : !glfwWindowShouldClose(window))
 	{
-		// input
-		// -----
-		processInput(window);
+		PROFILE_SCOPE("frame");
+		ALLOC_SCOPE("frame");
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		// headless and replayed frames are a fixed 1/60 s apart
+		if (lockstep) {
+			deltaTime = 1.0f / 60.0f;
+		}
+		else {
+			float currentFrame = static_cast<float>(glfwGetTime());
+			deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+		}
+		if (options.headless)
+			glBeginQuery(GL_TIME_ELAPSED, gpuQueries[frame]);
+		gpuProfiler.beginFrame();
+		int frameScope = gpuProfiler.begin("frame");
+
+		// input and the latest simulated state
+		// ------------------------------------
+		float alpha;
+		const GameSnapshot* snapshot;
+		if (lockstep) {
+			// this frame's ticks were requested last frame; queue the next frame's before drawing this one
+			{
+				PROFILE_SCOPE("sim.wait");
+				ALLOC_SCOPE("sim.wait");
+				snapshot = &sim.wait();
+			}
+			alpha = snapshot->alpha;
+			if (options.headless)
+				scriptedInput(snapshot->time, snapshot->platePosition.x, input);
+			else
+				processInput(window, input); // only Escape and F3 matter, the replay steers
+			sim.request(1.0 / 60.0, input);
+		}
+		else {
+			processInput(window, input);
+			sim.setInput(input);
+			snapshot = &sim.latest();
+			alpha = std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot->tickTime).count() / snapshot->tickDt;
+			alpha = glm::clamp(alpha, 0.0f, 1.0f);
+		}
+		const GameSnapshot& game = *snapshot;
+		statsRegistry().set(STAT_LIVE_FOODS, game.foods.size());
+
+		if (game.numberOfCollisions != lastCollisions)
+			snprintf(collisionMessage, sizeof(collisionMessage), "Object collected: %d", game.numberOfCollisions);
+		if (game.numberOfObject != lastObjects) {
+			LOG_DEBUG(GAME, "Spawned at %g with speed %g with delay %g", game.time, game.foodSpeed, game.delay);
+			snprintf(objectMessage, sizeof(objectMessage), "Object dropped: %d", game.numberOfObject);
+		}
+		lastCollisions = game.numberOfCollisions;
+		lastObjects = game.numberOfObject;
 
 		// render
 		// ------
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glState().disable(GL_BLEND); // the text pass turns it on
 
 		/*glBindVertexArray(lightCubeVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 36);*/
 
-		// Handle continuous cube appearance
-		float currentTime = static_cast<float>(glfwGetTime());
-
-		if (currentTime >= pastDifficulty + increaseDifficulty) {
-			if (level > 1) cubeSpeed += 0.003f / level;
-			delay -= 0.5f / level;
-			pastDifficulty = currentTime;
-			level++;
-		}
-
-		if (currentTime >= pastTime + delay) {
-			// keep adding cubes
-			Food food;
-			food.position = generateRandomPosition();
-			food.type = generateRandomObject();	
-			foods.push_back(food);
-
-			//objectsPositions.push_back(generateRandomPosition());
-			std::cout << "Spawned at " << currentTime << " with speed " << cubeSpeed << " with delay " << delay << std::endl;
-			numberOfObject++;
-			// update pastTime for delay
-			pastTime = currentTime;
-
-			objectMessage = "Object dropped: " + std::to_string(numberOfObject);
-		}
+		// Set projection and view matrices
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), viewAspect, 0.1f, 100.0f);
+		glm::mat4 view = camera.GetViewMatrix();
 
 		// RENDER CUBES
-		ourShader.use();
-		for (unsigned int i = 0; i < foods.size(); i++) {
-
-			if (foods[i].position.y <= -1.10f) {
-				// Reset or remove objects off-screen
-				continue;
-			}
-
-			// Update position
-			foods[i].position.y -= cubeSpeed;
-
-			// Create AABB for the current object after position update
-			AABB objectAABB = createAABB(foods[i].position);
-
-			// Create AABB for the plate (static position)
-			AABB plateAABB = createAABB(platePosition);
-
-			// Check for collision
-			if (checkCollision(objectAABB, plateAABB)) {
-				numberOfCollisions++;
-				// Optional: handle collision, e.g., remove object or reset position
-				foods[i].position.y = -10.0f; // Move off-screen after collision
+		float angle = (float)(game.time - (1.0f - alpha) * game.tickDt); // Use the interpolated game time as the angle in radians
+
+		// all foods share scale and spin per type, so only the translation differs per instance
+		Frustum frustum;
+		frustum.extract(projection * view);
+		glm::mat4 foodRotation = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::vec3 typeCenters[3];
+		float typeRadii[3];
+		AABB typeBoxes[3];
+		for (int t = 0; t < 3; t++) {
+			glm::mat4 scaleRotate = glm::scale(glm::mat4(1.0f), foodScales[t]) * foodRotation;
+			typeCenters[t] = glm::vec3(scaleRotate * glm::vec4(foodTypeSpheres[t].center, 1.0f));
+			typeRadii[t] = foodTypeSpheres[t].radius * std::fmax(foodScales[t].x, std::fmax(foodScales[t].y, foodScales[t].z));
+			typeBoxes[t] = transformAABB(foodTypeBounds[t], scaleRotate);
+		}
 
-				collisionMessage = "Object collected: " + std::to_string(numberOfCollisions);
-				soundEngine->play2D("C:/Users/franc/OneDrive/Documents/Coding/OpenGL/del3/del3/OpenGLApp/pickup_sound.wav", false);
+		{
+			PROFILE_SCOPE("foods.update");
+			ALLOC_SCOPE("foods.update");
+			foodSpheres.clear();
+			for (unsigned int i = 0; i < game.foods.size(); i++) {
+				const Food& f = game.foods[i];
+				// collected on the last tick
+				if (f.previous.y <= -1.10f)
+					continue;
+				foodSpheres.add(i, game.foodPosition(i, alpha) + typeCenters[f.type], typeRadii[f.type]);
 			}
 
-			// Render cube
-			glm::mat4 objModel = glm::mat4(1.0f);
-			if (foods[i].type == 0) {
-				float angle = glfwGetTime(); // Use the current time as the angle in radians
-				objModel = glm::translate(objModel, foods[i].position);
-				objModel = glm::scale(objModel, glm::vec3(0.3f, 0.3f, 0.3f));
-				objModel = glm::rotate(objModel, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-
-				//ourShader.setInt("textureID", 1);	// still show the croissant white
-				ourShader.setMat4("model", objModel);
-				croissantModel.Draw(ourShader);
-			} else if (foods[i].type == 1) {
-				float angle = glfwGetTime(); // Use the current time as the angle in radians
-				objModel = glm::translate(objModel, foods[i].position);
-				objModel = glm::scale(objModel, glm::vec3(0.1f, 0.1f, 0.1f));
-				objModel = glm::rotate(objModel, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-
-				//ourShader.setInt("textureID", 1);	// still show the croissant white
-				ourShader.setMat4("model", objModel);
-				otherModel.Draw(ourShader);
-			}
-			else if (foods[i].type == 2) {
-				float angle = glfwGetTime(); // Use the current time as the angle in radians
-				objModel = glm::translate(objModel, foods[i].position);
-				objModel = glm::scale(objModel, glm::vec3(0.1f, 0.1f, 0.1f));
-				objModel = glm::rotate(objModel, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-
-				//ourShader.setInt("textureID", 1);	// still show the croissant white
-				ourShader.setMat4("model", objModel);
-				muffinModel.Draw(ourShader);
+			// sphere test first, the box only for what survives it
+			foodSpheres.cull(frustum);
+			// box tests and model matrices spread over the job threads; large batches only, small ones run inline
+			glm::mat4* foodMatrices = frameArena().allocArray<glm::mat4>(foodSpheres.size());
+			jobs.parallelFor(foodSpheres.size(), 512, [&](unsigned int begin, unsigned int end) {
+				PROFILE_SCOPE("foods.chunk");
+				for (unsigned int k = begin; k < end; k++) {
+					const Food& f = game.foods[foodSpheres.ids[k]];
+					glm::vec3 position = game.foodPosition(foodSpheres.ids[k], alpha);
+					AABB box = { typeBoxes[f.type].min + position, typeBoxes[f.type].max + position };
+					if (!foodSpheres.visible[k] || !frustum.intersects(box)) {
+						foodSpheres.visible[k] = 0;
+						continue;
+					}
+					glm::mat4 objModel = glm::mat4(1.0f);
+					objModel = glm::translate(objModel, position);
+					objModel = glm::scale(objModel, foodScales[f.type]);
+					objModel = glm::rotate(objModel, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+					foodMatrices[k] = objModel;
+				}
+			});
+			// Queue cubes for the batched draw, in order
+			visibleFoods = 0;
+			culledFoods = 0;
+			for (unsigned int k = 0; k < foodSpheres.size(); k++) {
+				if (!foodSpheres.visible[k]) {
+					culledFoods++;
+					continue;
+				}
+				visibleFoods++;
+				foodBatch.add(game.foods[foodSpheres.ids[k]].type, foodMatrices[k]);
 			}
-			glBindVertexArray(VAO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
 		}
 
-		// Bind textures
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		ourShader.setInt("texture1", 0);
-
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-		ourShader.setInt("texture2", 1);
-
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, texture3);
-		ourShader.setInt("texture3", 2);
+		// every food in one submission
+		{
+			GpuScope gpu(gpuProfiler, "foods");
+			PROFILE_SCOPE("foods.submit");
+			ALLOC_SCOPE("foods.submit");
+			foodShader.use();
+			foodShader.setMat4("projection", projection);
+			foodShader.setMat4("view", view);
+			glState().bindTexture(0, 0); // food meshes have no textures of their own
+			foodBatch.submit();
+		}
 
-		// Set projection and view matrices
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		ourShader.setMat4("projection", projection);
-		glm::mat4 view = camera.GetViewMatrix();
-		ourShader.setMat4("view", view);
+		// Bind textures (sampler units were assigned once before the loop)
+		glState().bindTexture(0, texture1);
+		glState().bindTexture(1, texture2);
+		glState().bindTexture(2, texture3);
 
 		// Render conveyor belt
 		ourShader.use();
-		glBindVertexArray(conveyorVAO);
+		ourShader.setMat4("projection", projection);
+		ourShader.setMat4("view", view);
 		// Apply transformations if needed
 		/*glm::mat4 model = glm::translate(glm::mat4(1.0f), conveyorBeltPosition);
 		ourShader.setMat4("model", model);
 		ourShader.setInt("textureID", 3);
 		glDrawArrays(GL_TRIANGLES, 0, 6);*/
 		glm::mat4 model = glm::mat4(1.0f);
-		for (int i = 0; i < 2; i++) {
-			conveyorBeltPositions[i].y -= conveyorSpeed;
-			if (conveyorBeltPositions[i].y <= -2.4f) {
-				// Reset position when off-screen
-				conveyorBeltPositions[i].y = 2.4f;
-			}
-
-			// Render the conveyor belt
-			glm::mat4 conveyorModel = glm::mat4(1.0f);
-			conveyorModel = glm::translate(conveyorModel, conveyorBeltPositions[i]);
-			ourShader.setMat4("model", conveyorModel);
+		{
+			GpuScope gpu(gpuProfiler, "belt");
+			PROFILE_SCOPE("belt.draw");
+			ALLOC_SCOPE("belt.draw");
+			glState().bindVertexArray(conveyorVAO);
 			ourShader.setInt("textureID", 3); // Set the conveyor belt texture
-			glBindVertexArray(conveyorVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+			for (int i = 0; i < 2; i++) {
+				// Render the conveyor belt
+				glm::mat4 conveyorModel = glm::mat4(1.0f);
+				conveyorModel = glm::translate(conveyorModel, game.belt(i, alpha));
+				ourShader.setMat4("model", conveyorModel);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+				countDraw(2);
+			}
 		}
 
 		// be sure to activate shader when setting uniforms/drawing objects
@@ -858,15 +919,16 @@ int main()
 		ourShader.setFloat("material.shininess", 32.0f);
 
 		// Render plate
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glBindVertexArray(plateVAO);
-		model = glm::translate(glm::mat4(1.0f), platePosition);
-		model = glm::scale(model, glm::vec3(0.15f, 0.15f, 0.15f));
-		ourShader.setMat4("model", model);
-		ourShader.setInt("textureID", 1);
-		plateModel.Draw(ourShader);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		{
+			GpuScope gpu(gpuProfiler, "plate");
+			ALLOC_SCOPE("plate.draw");
+			glState().bindTexture(0, texture1);
+			model = glm::translate(glm::mat4(1.0f), game.plate(alpha));
+			model = glm::scale(model, plateScale);
+			ourShader.setMat4("model", model);
+			ourShader.setInt("textureID", 1);
+			plateModel.Draw(ourShader);
+		}
 
 		// Render cube
 		/*
@@ -882,22 +944,157 @@ int main()
 		*/
 
 		// Render text
-		glUseProgram(shader.ID); // Use text shader
-		renderText(shader, objectMessage, 10.0f, 550.0f, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
-		renderText(shader, collisionMessage, 10.0f, 480.0f, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
+		{
+			GpuScope gpu(gpuProfiler, "text");
+			ALLOC_SCOPE("text.hud");
+			renderText(shader, objectMessage, 10.0f, 550.0f, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
+			renderText(shader, collisionMessage, 10.0f, 480.0f, 0.6f, glm::vec3(1.0f, 1.0f, 1.0f));
+			if (showDebugOverlay) {
+				// overlay strings live in the frame arena until the swap
+				FrameArena& arena = frameArena();
+				renderText(shader, arena.format("Foods visible: %d  culled: %d", visibleFoods, culledFoods),
+					10.0f, 20.0f, 0.4f, glm::vec3(1.0f, 1.0f, 0.0f));
+				renderText(shader, arena.format("Broadphase: %u pairs (%u food-food, %u dropped)  %.1f us", game.broadphasePairs, game.foodFoodPairs,
+					game.droppedPairs, game.broadphaseMicros),
+					220.0f, 20.0f, 0.4f, glm::vec3(1.0f, 1.0f, 0.0f));
+				// GPU pass timings, one line each above the culling counters
+				const std::vector<GpuProfiler::PassStats>& passes = gpuProfiler.passes();
+				for (unsigned int i = 0; i < passes.size(); i++) {
+					renderText(shader, arena.format("GPU %-6s avg %.3f ms  max %.3f ms", passes[i].name.c_str(), passes[i].avgMs, passes[i].maxMs),
+						10.0f, 40.0f + 18.0f * i, 0.35f, glm::vec3(1.0f, 1.0f, 0.0f));
+				}
+
+				// performance HUD, top right: the last frame's counters and the frame times of the last few seconds
+				const StatsRegistry::Summary& perf = statsRegistry().summary();
+				glm::vec3 hudColor(0.6f, 1.0f, 0.6f);
+				renderText(shader, arena.format("FPS %.1f  (last %.0f s)", perf.fps, statsRegistry().windowSeconds), 520.0f, 580.0f, 0.35f, hudColor);
+				renderText(shader, arena.format("CPU ms  p50 %.2f  p95 %.2f  p99 %.2f", perf.cpuP50, perf.cpuP95, perf.cpuP99), 520.0f, 562.0f, 0.35f, hudColor);
+				renderText(shader, arena.format("GPU ms  p50 %.2f  p95 %.2f  p99 %.2f", perf.gpuP50, perf.gpuP95, perf.gpuP99), 520.0f, 544.0f, 0.35f, hudColor);
+				renderText(shader, arena.format("Draws %llu  triangles %llu", statsRegistry().frameValue(STAT_DRAW_CALLS),
+					statsRegistry().frameValue(STAT_TRIANGLES)), 520.0f, 526.0f, 0.35f, hudColor);
+				renderText(shader, arena.format("Texture binds %llu  foods %llu", statsRegistry().frameValue(STAT_TEXTURE_BINDS),
+					statsRegistry().frameValue(STAT_LIVE_FOODS)), 520.0f, 508.0f, 0.35f, hudColor);
+				renderText(shader, arena.format("Allocations/frame %llu (render %llu)  %llu bytes", statsRegistry().frameValue(STAT_ALLOCATIONS),
+					statsRegistry().frameValue(STAT_RENDER_ALLOCATIONS), statsRegistry().frameValue(STAT_ALLOCATED_BYTES)), 520.0f, 490.0f, 0.35f, hudColor);
+				renderText(shader, arena.format("Frame arena %.1f of %.0f KB", statsRegistry().frameValue(STAT_FRAME_ARENA_BYTES) / 1024.0,
+					arena.size() / 1024.0), 520.0f, 472.0f, 0.35f, hudColor);
+				// both graphs span 0..33 ms, two frames at 60 Hz
+				renderText(shader, "CPU", 520.0f, 432.0f, 0.3f, hudColor);
+				renderGraph(shader, graphMs, statsRegistry().cpuHistory(graphMs, GRAPH_FRAMES), 550.0f, 422.0f, 240.0f, 40.0f, 33.3f, hudColor);
+				renderText(shader, "GPU", 520.0f, 382.0f, 0.3f, glm::vec3(1.0f, 0.7f, 0.3f));
+				renderGraph(shader, graphMs, statsRegistry().gpuHistory(graphMs, GRAPH_FRAMES), 550.0f, 372.0f, 240.0f, 40.0f, 33.3f, glm::vec3(1.0f, 0.7f, 0.3f));
+			}
+		}
+		gpuProfiler.end(frameScope);
+		gpuProfiler.endFrame();
+
+		// allocations since the last frame ended: every thread's, and the render thread's own
+		double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		unsigned long long allocations = allocationCount();
+		unsigned long long bytes = allocatedBytes();
+		unsigned long long renderAllocations = threadAllocationCount();
+		statsRegistry().set(STAT_ALLOCATIONS, allocations - frameAllocations);
+		statsRegistry().set(STAT_ALLOCATED_BYTES, bytes - frameBytes);
+		statsRegistry().set(STAT_RENDER_ALLOCATIONS, renderAllocations - frameRenderAllocations);
+		statsRegistry().set(STAT_FRAME_ARENA_BYTES, frameArena().used());
+		frameAllocations = allocations;
+		frameBytes = bytes;
+		frameRenderAllocations = renderAllocations;
+		statsRegistry().endFrame(frameMs);
+		if (options.allocReport && ++allocFrames == ALLOC_WARMUP_FRAMES) {
+			allocSnapshot(allocStart);
+			allocCaptureSites(true);
+		}
+		if (telemetry.recording()) {
+			FrameRecord record;
+			record.frame = telemetryFrame++;
+			record.seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - telemetryStart).count();
+			record.frameMs = (float)frameMs;
+			record.simMs = game.simMs;
+			record.gpuMs = statsRegistry().newestGpuMs();
+			record.liveFoods = (unsigned int)statsRegistry().frameValue(STAT_LIVE_FOODS);
+			record.drawCalls = (unsigned int)statsRegistry().frameValue(STAT_DRAW_CALLS);
+			record.allocations = (unsigned int)statsRegistry().frameValue(STAT_ALLOCATIONS);
+			telemetry.push(record);
+		}
 
-		// Restore OpenGL state for 3D rendering
-		glBindVertexArray(0);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glDisable(GL_BLEND);
+		if (options.headless) {
+			glEndQuery(GL_TIME_ELAPSED);
+			cpuFrameMs.push_back(frameMs);
+			frame++;
+			frameArena().reset(); // no swap, the frame ends here
+			continue;
+		}
 
 		// Swap buffers and poll events
-		glfwSwapBuffers(window);
+		{
+			PROFILE_SCOPE("frame.swap");
+			glfwSwapBuffers(window);
+		}
+		// GL has copied everything the frame handed it, its scratch memory can go
+		frameArena().reset();
 		glfwPollEvents();
+		if (!options.replayPath.empty() && game.ticks >= replay.ticks())
+			glfwSetWindowShouldClose(window, true);
+	}
+	// before shutdown adds allocations of its own
+	if (options.allocReport) {
+		allocCaptureSites(false);
+		allocSnapshot(allocEnd);
 	}
 
-	std::cout << "Oggetti: " << numberOfObject << std::endl;
-	std::cout << "Collisioni: " << numberOfCollisions << std::endl;
+	sim.stop();
+	audio.stop();
+	if (mixerThread) {
+		mixerThread->stop();
+		std::cout << "Mixer: " << mixerThread->callbacks() << " buffers, mixing " << mixerThread->averageMixUs() << " us average, "
+			<< mixerThread->maxMixUs() << " us max of " << mixerThread->budgetUs() << " us; underruns: " << mixerThread->underruns() << std::endl;
+	}
+	music.stop();
+	if (telemetry.recording()) {
+		telemetry.close();
+		std::cout << "Telemetry: " << telemetry.written() << " frames written to " << options.telemetryPath << ", "
+			<< telemetry.dropped() << " dropped" << std::endl;
+	}
+	if (!options.recordPath.empty() && recording.save(options.recordPath))
+		std::cout << "Recorded " << recording.ticks() << " ticks to " << options.recordPath << std::endl;
+
+	if (options.headless) {
+		// results are only read back now, so no frame ever waited on the GPU
+		std::vector<double> gpuFrameMs;
+		for (int i = 0; i < options.frames; i++) {
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(gpuQueries[i], GL_QUERY_RESULT, &ns);
+			gpuFrameMs.push_back(ns / 1.0e6);
+		}
+		glDeleteQueries(options.frames, gpuQueries.data());
+
+		std::cout << "Headless run: " << options.frames << " frames at " << options.width << "x" << options.height << std::endl;
+		std::cout << "CPU frame ms  p50 " << percentile(cpuFrameMs, 50) << "  p90 " << percentile(cpuFrameMs, 90)
+			<< "  p99 " << percentile(cpuFrameMs, 99) << "  max " << percentile(cpuFrameMs, 100) << std::endl;
+		std::cout << "GPU frame ms  p50 " << percentile(gpuFrameMs, 50) << "  p90 " << percentile(gpuFrameMs, 90)
+			<< "  p99 " << percentile(gpuFrameMs, 99) << "  max " << percentile(gpuFrameMs, 100) << std::endl;
+
+		if (!options.pngPath.empty() && writePNG(options.pngPath, offscreen.width, offscreen.height, offscreen.readPixels()))
+			std::cout << "Last frame written to " << options.pngPath << std::endl;
+	}
+
+	std::cout << "Seed: " << options.seed << ", ticks: " << sim.game.ticks << std::endl;
+	std::cout << "Oggetti: " << sim.game.numberOfObject << std::endl;
+	std::cout << "Collisioni: " << sim.game.numberOfCollisions << std::endl;
+	std::cout << "Sound events posted: " << audio.posted() << ", played: " << audio.played() << ", dropped: " << audio.dropped()
+		<< "; voices stolen: " << voices.stolen() << ", rejected: " << voices.rejected() << std::endl;
+	std::cout << "GL state calls issued: " << glState().issued << ", skipped: " << glState().skipped << std::endl;
+	if (options.allocReport) {
+		if (allocFrames > ALLOC_WARMUP_FRAMES)
+			printAllocReport(allocStart, allocEnd, allocFrames - ALLOC_WARMUP_FRAMES);
+		else
+			std::cout << "Allocation report: no frames after the " << ALLOC_WARMUP_FRAMES << " of warm-up" << std::endl;
+	}
+	if (!options.tracePath.empty()) {
+		profiler().stop();
+		profiler().writeChromeTrace(options.tracePath);
+	}
 
 	// optional: de-allocate all resources once they've outlived their purpose:
 	// ------------------------------------------------------------------------
@@ -907,10 +1104,18 @@ int main()
 	glDeleteVertexArrays(1, &plateVAO);
 	glDeleteBuffers(1, &plateVBO);
 
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
+	glDeleteVertexArrays(1, &graphVAO);
+	glDeleteBuffers(1, &graphVBO);
+	glDeleteTextures(1, &graphTexture);
 
-	soundEngine->drop();
+	foodBatch.destroy();
+	gpuProfiler.destroy();
+
+	if (options.headless) {
+		offscreen.destroy();
+		headless.destroy();
+		return 0;
+	}
 
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
@@ -918,87 +1123,26 @@ int main()
 	return 0;
 }
 
-// Helper function for loading textures
-unsigned int TextureFromFile(const char* path, const std::string& directory) {
-	std::string filename = directory + "/" + std::string(path);
-	std::cout << "Loading texture: " << filename << std::endl;
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else {
-		std::cerr << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-	return textureID;
-}
-
-glm::vec3 generateRandomPosition() {
-	static std::random_device rd; // Seed
-	static std::mt19937 gen(rd()); // Random number generator
-	static std::uniform_int_distribution<int> distX(0, 2); // Distribution for x
-
-	// Fixed x positions
-	float xPositions[3] = { -0.50f, 0.0f, 0.50f };
-
-	int randomIndex = distX(gen); // Pick a random index
-	float randomX = xPositions[randomIndex];
-
-	/*float randomX = distX(gen);*/
-	return glm::vec3(randomX, 1.20f, 0.0f); // Fixed y and z
-}
-
-int generateRandomObject() {
-	static std::random_device rd; // Seed
-	static std::mt19937 gen(rd()); // Random number generator
-	static std::uniform_int_distribution<int> dist(0, 2); // Distribution for x
-
-	return dist(gen); 
-}
-
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+void processInput(GLFWwindow* window, GameInput& input)
 {
+	PROFILE_SCOPE("input.process");
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
 
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-		if (platePosition.x <= 0.45f) // if plate in border
-			platePosition.x += 0.03f;  // Move plate right
-		else {
-			platePosition.x = 0.45f;
-			// soundEngine->play2D("C:/Users/aagar/Documents/InfoGrafica/OpenGLApp  - demos/OpenGLApp/OpenGLApp/hitting_wall.wav", false);
-		}
-	}
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-		if (platePosition.x >= -0.45f) // if plate in border
-			platePosition.x -= 0.03f;  // Move plate left
-		else {
-			platePosition.x = -0.45f;
-			// soundEngine->play2D("C:/Users/aagar/Documents/InfoGrafica/OpenGLApp  - demos/OpenGLApp/OpenGLApp/hitting_wall.wav", false);
-		}
-	}
+	// toggle the debug overlay on the press, not while held
+	static bool f3WasDown = false;
+	bool f3Down = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+	if (f3Down && !f3WasDown)
+		showDebugOverlay = !showDebugOverlay;
+	f3WasDown = f3Down;
+
+	input.plateDirection = 0;
+	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+		input.plateDirection += 1;
+	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+		input.plateDirection -= 1;
 
 	/*
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
@@ -1048,49 +1192,39 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 	camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-// Function to create an AABB from position
-AABB createAABB(const glm::vec3& position) {
-	// Assuming the object has a fixed size of 0.2f x 0.2f 
-	float halfWidth = 0.1f;  // Half of the object's width
-	float halfHeight = 0.1f; // Half of the object's height
-
-	return AABB{
-		glm::vec3(position.x - halfWidth, position.y - halfHeight, position.z - 0.01f),  // min
-		glm::vec3(position.x + halfWidth, position.y + halfHeight, position.z + 0.01f)   // max
-	};
-}
-
-// Function to check for collision between two AABBs
-bool checkCollision(const AABB& a, const AABB& b) {
-	return (a.max.x >= b.min.x && a.min.x <= b.max.x) &&
-		(a.max.y >= b.min.y && a.min.y <= b.max.y) &&
-		(a.max.z >= b.min.z && a.min.z <= b.max.z);
-}
-
-void renderText(Shader& s, std::string text, float x, float y, float scale, glm::vec3 color) {
+void renderText(Shader& s, const char* text, float x, float y, float scale, glm::vec3 color) {
+	PROFILE_SCOPE("text.render");
 	// activate corresponding render state	
 	s.use();
 	glUniform3f(glGetUniformLocation(s.ID, "textColor"), color.x, color.y, color.z);
 
 	// Enable blending to handle glyph transparency
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(txtVAO);
-
-	// iterate through all characters
-	std::string::const_iterator c;
-	for (c = text.begin(); c != text.end(); c++)
+	glState().enable(GL_BLEND);
+	glState().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glState().bindVertexArray(txtVAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, txtVBO);
+
+	// every glyph's quad in the frame arena first, so the string is one upload
+	size_t length = std::strlen(text);
+	if (length == 0)
+		return;
+	float (*quads)[6][4] = static_cast<float (*)[6][4]>(frameArena().allocate(length * sizeof(float[6][4]), alignof(float)));
+	unsigned int* glyphTextures = frameArena().allocArray<unsigned int>(length);
+	size_t glyphs = 0;
+	for (size_t i = 0; i < length; i++)
 	{
-		Character ch = Characters[*c];
+		// find(), not operator[]: a character the font lacks is skipped instead of inserted
+		std::map<char, Character>::const_iterator found = Characters.find(text[i]);
+		if (found == Characters.end())
+			continue;
+		const Character& ch = found->second;
 
 		float xpos = x + ch.Bearing.x * scale;
 		float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
 
 		float w = ch.Size.x * scale;
 		float h = ch.Size.y * scale;
-		// update VBO for each character
 		float vertices[6][4] = {
 			{ xpos,     ypos + h,   0.0f, 0.0f },
 			{ xpos,     ypos,       0.0f, 1.0f },
@@ -1100,17 +1234,52 @@ void renderText(Shader& s, std::string text, float x, float y, float scale, glm:
 			{ xpos + w, ypos,       1.0f, 1.0f },
 			{ xpos + w, ypos + h,   1.0f, 0.0f }
 		};
-		// render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-		// update content of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, txtVBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		// render quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		std::memcpy(quads[glyphs], vertices, sizeof(vertices));
+		glyphTextures[glyphs++] = ch.TextureID;
 		// now advance cursors for next glyph (note that advance is number of 1/64 pixels)
 		x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64)
 	}
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	if (glyphs == 0)
+		return;
+	// orphan and refill, like the food instances, so no earlier string's draws are waited on
+	glBufferData(GL_ARRAY_BUFFER, glyphs * sizeof(float[6][4]), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, glyphs * sizeof(float[6][4]), quads);
+
+	// render glyph texture over quad
+	for (size_t i = 0; i < glyphs; i++)
+	{
+		glState().bindTexture(0, glyphTextures[i]);
+		glDrawArrays(GL_TRIANGLES, (GLint)(i * 6), 6);
+		countDraw(2);
+	}
+}
+
+// one bar per value, newest on the right, scaled so maxValue fills height; taller values are clipped
+void renderGraph(Shader& s, const float* values, unsigned int count, float x, float y, float width, float height, float maxValue, glm::vec3 color) {
+	if (count == 0)
+		return;
+	count = std::min(count, GRAPH_FRAMES);
+	float (*vertices)[6][4] = static_cast<float (*)[6][4]>(frameArena().allocate(count * sizeof(float[6][4]), alignof(float)));
+	float barWidth = width / GRAPH_FRAMES;
+	float left = x + width - count * barWidth;
+	for (unsigned int i = 0; i < count; i++) {
+		float x0 = left + i * barWidth, x1 = x0 + barWidth * 0.8f;
+		float y1 = y + height * std::fmin(values[i] / maxValue, 1.0f);
+		float quad[6][4] = {
+			{ x0, y1, 0.0f, 0.0f }, { x0, y, 0.0f, 0.0f }, { x1, y, 0.0f, 0.0f },
+			{ x0, y1, 0.0f, 0.0f }, { x1, y, 0.0f, 0.0f }, { x1, y1, 0.0f, 0.0f }
+		};
+		std::copy(&quad[0][0], &quad[0][0] + 24, &vertices[i][0][0]);
+	}
+
+	s.use();
+	glUniform3f(glGetUniformLocation(s.ID, "textColor"), color.x, color.y, color.z);
+	glState().enable(GL_BLEND);
+	glState().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glState().bindVertexArray(graphVAO);
+	glState().bindBuffer(GL_ARRAY_BUFFER, graphVBO);
+	glState().bindTexture(0, graphTexture);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(float[6][4]), vertices);
+	glDrawArrays(GL_TRIANGLES, 0, count * 6);
+	countDraw(count * 2);
 }
\ No newline at end of file
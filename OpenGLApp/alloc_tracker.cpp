@@ -0,0 +1,2 @@
+#define ALLOC_TRACKER_IMPLEMENTATION
+#include "alloc_tracker.h"
\ No newline at end of file
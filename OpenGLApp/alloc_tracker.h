@@ -0,0 +1,469 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+// Counts every heap allocation made through operator new: in total, per
+// thread, per subsystem and, once site capture is switched on, per call site.
+// The replacement operators are defined once, in alloc_tracker.cpp, which
+// includes this file with ALLOC_TRACKER_IMPLEMENTATION. Build with
+// ALLOC_TRACKER_ENABLED 0 to keep the library's operators; the counts then
+// stay at zero and ALLOC_SCOPE compiles to nothing.
+//
+//   ALLOC_SCOPE("foods.submit"); // the rest of the block, on this thread
+//
+// The target is a steady-state frame that allocates nothing; --alloc-report
+// prints what still does.
+#ifndef ALLOC_TRACKER_ENABLED
+#define ALLOC_TRACKER_ENABLED 1
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+// the code that called operator new
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_ReturnAddress)
+#define ALLOC_CALLER() _ReturnAddress()
+#else
+#define ALLOC_CALLER() __builtin_return_address(0)
+#endif
+
+enum : unsigned int {
+	ALLOC_THREADS = 64, // the last slot also takes every thread beyond it
+	ALLOC_SCOPES = 32,  // 0 is everything outside an ALLOC_SCOPE
+	ALLOC_SITES = 4096, // open addressing, keyed by return address
+	ALLOC_NAME = 24,
+};
+
+struct AllocCount {
+	std::atomic<unsigned long long> allocations{ 0 };
+	std::atomic<unsigned long long> bytes{ 0 };
+};
+
+struct AllocSite {
+	std::atomic<std::uintptr_t> address{ 0 };
+	AllocCount count;
+};
+
+// constant initialized, so it is usable by allocations made before main()
+struct AllocCounters {
+	std::atomic<unsigned long long> allocations{ 0 };
+	std::atomic<unsigned long long> frees{ 0 };
+	std::atomic<unsigned long long> bytes{ 0 };
+	std::atomic<long long> liveBytes{ 0 }; // held right now, in heap block sizes; 0 where the heap cannot tell
+	AllocCount threads[ALLOC_THREADS];
+	char threadNames[ALLOC_THREADS][ALLOC_NAME] = {};
+	std::atomic<unsigned int> threadCount{ 0 };
+	AllocCount scopes[ALLOC_SCOPES];
+	const char* scopeNames[ALLOC_SCOPES] = {};
+	std::atomic<unsigned int> scopeCount{ 1 };
+	// off unless asked for: a site costs a hash probe on every allocation
+	std::atomic<bool> captureSites{ false };
+	AllocSite sites[ALLOC_SITES];
+	std::atomic<unsigned long long> lostSites{ 0 }; // the table was full
+};
+
+inline AllocCounters& allocCounters()
+{
+	static AllocCounters counters;
+	return counters;
+}
+
+// allocations since startup, from every thread
+inline unsigned long long allocationCount() { return allocCounters().allocations.load(std::memory_order_relaxed); }
+inline unsigned long long allocatedBytes() { return allocCounters().bytes.load(std::memory_order_relaxed); }
+// bytes allocated and not freed yet; a steady state keeps this flat
+inline long long liveHeapBytes() { return allocCounters().liveBytes.load(std::memory_order_relaxed); }
+
+// this thread's slot, claimed at its first allocation or when it is named
+inline unsigned int allocThreadSlot()
+{
+	static thread_local unsigned int slot = 0; // index + 1
+	if (!slot) {
+		unsigned int claimed = allocCounters().threadCount.fetch_add(1, std::memory_order_relaxed);
+		slot = std::min<unsigned int>(claimed, ALLOC_THREADS - 1) + 1;
+	}
+	return slot - 1;
+}
+
+// allocations since startup, from the calling thread only
+inline unsigned long long threadAllocationCount()
+{
+	return allocCounters().threads[allocThreadSlot()].allocations.load(std::memory_order_relaxed);
+}
+
+// what this thread's allocations are counted under
+inline unsigned int& allocScopeSlot()
+{
+	static thread_local unsigned int scope = 0;
+	return scope;
+}
+
+// PROFILE_THREAD names the thread here too, so the report can tell them apart
+inline void allocThreadName(const std::string& name)
+{
+	unsigned int slot = allocThreadSlot();
+	if (slot < ALLOC_THREADS - 1)
+		std::snprintf(allocCounters().threadNames[slot], ALLOC_NAME, "%s", name.c_str());
+}
+
+// index of a subsystem, registered at its first use; 0 once the table is full
+inline unsigned int allocScopeIndex(const char* name)
+{
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
+	AllocCounters& counters = allocCounters();
+	unsigned int count = counters.scopeCount.load(std::memory_order_relaxed);
+	for (unsigned int i = 1; i < count; i++) {
+		if (std::strcmp(counters.scopeNames[i], name) == 0)
+			return i;
+	}
+	if (count == ALLOC_SCOPES)
+		return 0;
+	counters.scopeNames[count] = name;
+	counters.scopeCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+// Counts the calling thread's allocations under a subsystem until it goes
+// out of scope. Jobs it hands to other threads are counted there, as theirs.
+class AllocScope {
+public:
+	explicit AllocScope(unsigned int scope) : previous(allocScopeSlot()) { allocScopeSlot() = scope; }
+	~AllocScope() { allocScopeSlot() = previous; }
+	AllocScope(const AllocScope&) = delete;
+	AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+	unsigned int previous;
+};
+
+#if ALLOC_TRACKER_ENABLED
+#define ALLOC_CONCAT_INNER(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_INNER(a, b)
+// the name is looked up once per call site, never inside operator new
+#define ALLOC_SCOPE(name) static const unsigned int ALLOC_CONCAT(allocScopeId, __LINE__) = allocScopeIndex(name); \
+	AllocScope ALLOC_CONCAT(allocScope, __LINE__)(ALLOC_CONCAT(allocScopeId, __LINE__))
+#else
+#define ALLOC_SCOPE(name)
+#endif
+
+// Every counter at one moment; a report covers what happened after it
+struct AllocSnapshot {
+	unsigned long long allocations = 0, bytes = 0;
+	unsigned long long threadAllocations[ALLOC_THREADS] = {}, threadBytes[ALLOC_THREADS] = {};
+	unsigned long long scopeAllocations[ALLOC_SCOPES] = {}, scopeBytes[ALLOC_SCOPES] = {};
+};
+
+inline void allocSnapshot(AllocSnapshot& snapshot)
+{
+	AllocCounters& counters = allocCounters();
+	snapshot.allocations = counters.allocations.load(std::memory_order_relaxed);
+	snapshot.bytes = counters.bytes.load(std::memory_order_relaxed);
+	for (unsigned int i = 0; i < ALLOC_THREADS; i++) {
+		snapshot.threadAllocations[i] = counters.threads[i].allocations.load(std::memory_order_relaxed);
+		snapshot.threadBytes[i] = counters.threads[i].bytes.load(std::memory_order_relaxed);
+	}
+	for (unsigned int i = 0; i < ALLOC_SCOPES; i++) {
+		snapshot.scopeAllocations[i] = counters.scopes[i].allocations.load(std::memory_order_relaxed);
+		snapshot.scopeBytes[i] = counters.scopes[i].bytes.load(std::memory_order_relaxed);
+	}
+}
+
+// site capture starts empty, so it only ever holds what came after
+inline void allocCaptureSites(bool capture)
+{
+	AllocCounters& counters = allocCounters();
+	if (capture) {
+		for (unsigned int i = 0; i < ALLOC_SITES; i++) {
+			counters.sites[i].address.store(0, std::memory_order_relaxed);
+			counters.sites[i].count.allocations.store(0, std::memory_order_relaxed);
+			counters.sites[i].count.bytes.store(0, std::memory_order_relaxed);
+		}
+		counters.lostSites.store(0, std::memory_order_relaxed);
+	}
+	counters.captureSites.store(capture, std::memory_order_release);
+}
+
+// "module+0xoffset" (with the symbol where the platform knows it) of a code
+// address; defined with the operators, in alloc_tracker.cpp
+void allocSiteName(const void* address, char* out, std::size_t size);
+
+// --alloc-report: allocations per frame between two snapshots, by thread, by
+// subsystem and, if sites were captured meanwhile, by call site
+inline void printAllocReport(const AllocSnapshot& since, const AllocSnapshot& now, unsigned long long frames)
+{
+	AllocCounters& counters = allocCounters();
+	double perFrame = frames ? 1.0 / frames : 0.0;
+	char line[256];
+	snprintf(line, sizeof(line), "Allocations over %llu frames: %llu, %.3f/frame, %.1f bytes/frame", frames,
+		now.allocations - since.allocations, (now.allocations - since.allocations) * perFrame, (now.bytes - since.bytes) * perFrame);
+	std::cout << line << std::endl;
+
+	unsigned int threadCount = std::min<unsigned int>(counters.threadCount.load(std::memory_order_relaxed), ALLOC_THREADS);
+	for (unsigned int i = 0; i < threadCount; i++) {
+		unsigned long long n = now.threadAllocations[i] - since.threadAllocations[i];
+		if (!n)
+			continue;
+		char fallback[ALLOC_NAME];
+		if (i == ALLOC_THREADS - 1)
+			snprintf(fallback, sizeof(fallback), "other threads");
+		else
+			snprintf(fallback, sizeof(fallback), "thread %u", i);
+		snprintf(line, sizeof(line), "  thread %-14s %8llu  %8.3f/frame %10.1f bytes/frame", counters.threadNames[i][0] ? counters.threadNames[i] : fallback,
+			n, n * perFrame, (now.threadBytes[i] - since.threadBytes[i]) * perFrame);
+		std::cout << line << std::endl;
+	}
+	unsigned int scopeCount = counters.scopeCount.load(std::memory_order_acquire);
+	for (unsigned int i = 0; i < scopeCount; i++) {
+		unsigned long long n = now.scopeAllocations[i] - since.scopeAllocations[i];
+		if (!n)
+			continue;
+		snprintf(line, sizeof(line), "  scope  %-14s %8llu  %8.3f/frame %10.1f bytes/frame", i ? counters.scopeNames[i] : "(none)",
+			n, n * perFrame, (now.scopeBytes[i] - since.scopeBytes[i]) * perFrame);
+		std::cout << line << std::endl;
+	}
+
+	std::vector<unsigned int> sites;
+	for (unsigned int i = 0; i < ALLOC_SITES; i++) {
+		if (counters.sites[i].address.load(std::memory_order_relaxed))
+			sites.push_back(i);
+	}
+	if (sites.empty())
+		return;
+	std::sort(sites.begin(), sites.end(), [&counters](unsigned int a, unsigned int b) {
+		return counters.sites[a].count.allocations.load(std::memory_order_relaxed) > counters.sites[b].count.allocations.load(std::memory_order_relaxed);
+	});
+	std::cout << "  top call sites (module+offset, for addr2line or the PDB):" << std::endl;
+	for (unsigned int i = 0; i < sites.size() && i < 20; i++) {
+		const AllocSite& site = counters.sites[sites[i]];
+		char name[128];
+		allocSiteName((const void*)site.address.load(std::memory_order_relaxed), name, sizeof(name));
+		unsigned long long n = site.count.allocations.load(std::memory_order_relaxed);
+		snprintf(line, sizeof(line), "  %8llu  %8.3f/frame %10.1f bytes/frame  %s", n, n * perFrame,
+			site.count.bytes.load(std::memory_order_relaxed) * perFrame, name);
+		std::cout << line << std::endl;
+	}
+	if (counters.lostSites.load(std::memory_order_relaxed))
+		std::cout << "  " << counters.lostSites.load(std::memory_order_relaxed) << " allocations from sites the table had no room for" << std::endl;
+}
+#endif
+
+#if defined(ALLOC_TRACKER_IMPLEMENTATION) && !defined(ALLOC_TRACKER_DEFINED)
+#define ALLOC_TRACKER_DEFINED
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <malloc.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+#if defined(__linux__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+void allocSiteName(const void* address, char* out, std::size_t size)
+{
+#if defined(_WIN32)
+	HMODULE module = nullptr;
+	char path[MAX_PATH];
+	if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)address, &module)
+		&& GetModuleFileNameA(module, path, MAX_PATH)) {
+		const char* file = std::strrchr(path, '\\');
+		std::snprintf(out, size, "%s+0x%llx", file ? file + 1 : path, (unsigned long long)((std::uintptr_t)address - (std::uintptr_t)module));
+		return;
+	}
+#elif defined(__unix__) || defined(__APPLE__)
+	Dl_info info;
+	if (dladdr(address, &info) && info.dli_fname) {
+		const char* file = std::strrchr(info.dli_fname, '/');
+		unsigned long long offset = (unsigned long long)((std::uintptr_t)address - (std::uintptr_t)info.dli_fbase);
+		if (info.dli_sname)
+			std::snprintf(out, size, "%s+0x%llx (%s)", file ? file + 1 : info.dli_fname, offset, info.dli_sname);
+		else
+			std::snprintf(out, size, "%s+0x%llx", file ? file + 1 : info.dli_fname, offset);
+		return;
+	}
+#endif
+	std::snprintf(out, size, "%p", address);
+}
+
+#if ALLOC_TRACKER_ENABLED
+// linear probing from the address hash; a full table only loses the site, not the count
+inline void trackSite(const void* caller, std::size_t size)
+{
+	AllocCounters& counters = allocCounters();
+	std::uintptr_t address = (std::uintptr_t)caller;
+	unsigned int start = (unsigned int)((address >> 2) * 2654435761u) % ALLOC_SITES;
+	for (unsigned int probe = 0; probe < 64; probe++) {
+		AllocSite& site = counters.sites[(start + probe) % ALLOC_SITES];
+		std::uintptr_t expected = site.address.load(std::memory_order_relaxed);
+		if (!expected && site.address.compare_exchange_strong(expected, address, std::memory_order_relaxed))
+			expected = address;
+		if (expected == address) {
+			site.count.allocations.fetch_add(1, std::memory_order_relaxed);
+			site.count.bytes.fetch_add(size, std::memory_order_relaxed);
+			return;
+		}
+	}
+	counters.lostSites.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void countAlloc(std::size_t size, const void* caller)
+{
+	AllocCounters& counters = allocCounters();
+	counters.allocations.fetch_add(1, std::memory_order_relaxed);
+	counters.bytes.fetch_add(size, std::memory_order_relaxed);
+	AllocCount& thread = counters.threads[allocThreadSlot()];
+	thread.allocations.fetch_add(1, std::memory_order_relaxed);
+	thread.bytes.fetch_add(size, std::memory_order_relaxed);
+	AllocCount& scope = counters.scopes[allocScopeSlot()];
+	scope.allocations.fetch_add(1, std::memory_order_relaxed);
+	scope.bytes.fetch_add(size, std::memory_order_relaxed);
+	if (counters.captureSites.load(std::memory_order_relaxed))
+		trackSite(caller, size);
+}
+
+// what the heap set aside for p, the same when it is allocated and when it is
+// freed, so live bytes add up; 0 where the platform cannot tell
+inline std::size_t heapBlockSize(void* p, std::size_t alignment = 0)
+{
+#if defined(_WIN32)
+	return alignment ? _aligned_msize(p, alignment, 0) : _msize(p);
+#elif defined(__linux__)
+	(void)alignment;
+	return malloc_usable_size(p);
+#elif defined(__APPLE__)
+	(void)alignment;
+	return malloc_size(p);
+#else
+	(void)p; (void)alignment;
+	return 0;
+#endif
+}
+
+inline void* trackedAlloc(std::size_t size, const void* caller)
+{
+	void* p = std::malloc(size ? size : 1);
+	if (p) {
+		countAlloc(size, caller);
+		allocCounters().liveBytes.fetch_add((long long)heapBlockSize(p), std::memory_order_relaxed);
+	}
+	return p;
+}
+
+inline void trackedFree(void* p)
+{
+	if (!p)
+		return;
+	AllocCounters& counters = allocCounters();
+	counters.frees.fetch_add(1, std::memory_order_relaxed);
+	counters.liveBytes.fetch_sub((long long)heapBlockSize(p), std::memory_order_relaxed);
+	std::free(p);
+}
+
+#ifdef __cpp_aligned_new
+// over-aligned types (alignas beyond the default) come through here; they need
+// the matching aligned free, which on Windows is not free()
+inline void* trackedAlignedAlloc(std::size_t size, std::align_val_t alignment, const void* caller)
+{
+	std::size_t align = static_cast<std::size_t>(alignment);
+	if (!size)
+		size = 1;
+#if defined(_WIN32)
+	void* p = _aligned_malloc(size, align);
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, std::max(align, sizeof(void*)), size) != 0)
+		p = nullptr;
+#endif
+	if (p) {
+		countAlloc(size, caller);
+		allocCounters().liveBytes.fetch_add((long long)heapBlockSize(p, align), std::memory_order_relaxed);
+	}
+	return p;
+}
+
+inline void trackedAlignedFree(void* p, std::align_val_t alignment)
+{
+	if (!p)
+		return;
+	AllocCounters& counters = allocCounters();
+	counters.frees.fetch_add(1, std::memory_order_relaxed);
+	counters.liveBytes.fetch_sub((long long)heapBlockSize(p, static_cast<std::size_t>(alignment)), std::memory_order_relaxed);
+#if defined(_WIN32)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+#endif
+
+void* operator new(std::size_t size)
+{
+	void* p = trackedAlloc(size, ALLOC_CALLER());
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new[](std::size_t size)
+{
+	void* p = trackedAlloc(size, ALLOC_CALLER());
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, ALLOC_CALLER()); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, ALLOC_CALLER()); }
+
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* p = trackedAlignedAlloc(size, alignment, ALLOC_CALLER());
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	void* p = trackedAlignedAlloc(size, alignment, ALLOC_CALLER());
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return trackedAlignedAlloc(size, alignment, ALLOC_CALLER()); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return trackedAlignedAlloc(size, alignment, ALLOC_CALLER()); }
+
+void operator delete(void* p, std::align_val_t alignment) noexcept { trackedAlignedFree(p, alignment); }
+void operator delete[](void* p, std::align_val_t alignment) noexcept { trackedAlignedFree(p, alignment); }
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept { trackedAlignedFree(p, alignment); }
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept { trackedAlignedFree(p, alignment); }
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { trackedAlignedFree(p, alignment); }
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept { trackedAlignedFree(p, alignment); }
+#endif
+#endif
+#endif
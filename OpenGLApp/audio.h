@@ -0,0 +1,133 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <glm/glm.hpp>
+
+#include "event_ring.h"
+#include "profiler.h"
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+enum SoundId : unsigned short {
+	SOUND_PICKUP,
+	SOUND_WALL,
+	SOUND_COUNT
+};
+
+// What gameplay asks the audio thread to play; small enough to copy around freely
+struct SoundEvent {
+	unsigned short id;
+	float gain;
+	glm::vec3 position;
+};
+
+// Plays sounds on a thread of its own, so no game or render frame ever waits
+// on the audio backend. Any thread posts SoundEvents into a lock-free ring;
+// the audio thread drains it every few milliseconds. Events of one sound that
+// arrive together (a handful of foods collected in the same tick) become one
+// playback, a bit louder, and a sound never restarts more often than every
+// minIntervalMs; what comes in faster is merged into the next one.
+class AudioThread
+{
+public:
+	// called on the audio thread only, once per playback
+	typedef std::function<void(const SoundEvent&)> PlayFunction;
+
+	unsigned int minIntervalMs = 40; // set before start()
+
+	void start(PlayFunction playFunction)
+	{
+		play = playFunction;
+		running.store(true, std::memory_order_release);
+		worker = std::thread(&AudioThread::run, this);
+	}
+
+	void stop()
+	{
+		running.store(false, std::memory_order_release);
+		if (worker.joinable())
+			worker.join();
+	}
+
+	~AudioThread() { stop(); }
+
+	// any thread, never blocks; false when the ring was full and the event dropped
+	bool post(const SoundEvent& event) { return ring.push(event); }
+
+	// totals, readable from any thread
+	unsigned int posted() const { return postedCount.load(std::memory_order_relaxed); }
+	unsigned int played() const { return playedCount.load(std::memory_order_relaxed); }
+	unsigned int dropped() const { return ring.droppedCount(); }
+
+private:
+	EventRing<SoundEvent, 256> ring;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::atomic<unsigned int> postedCount{ 0 };
+	std::atomic<unsigned int> playedCount{ 0 };
+	PlayFunction play;
+
+	struct Pending {
+		unsigned int count;
+		float gain;
+		glm::vec3 positionSum;
+	};
+
+	static void clear(Pending& p)
+	{
+		p.count = 0;
+		p.gain = 0.0f;
+		p.positionSum = glm::vec3(0.0f);
+	}
+
+	void run()
+	{
+		PROFILE_THREAD("audio");
+		typedef std::chrono::steady_clock Clock;
+		Pending pending[SOUND_COUNT];
+		Clock::time_point lastPlayed[SOUND_COUNT];
+		for (int i = 0; i < SOUND_COUNT; i++) {
+			clear(pending[i]);
+			lastPlayed[i] = Clock::now() - std::chrono::seconds(1);
+		}
+
+		for (;;) {
+			bool stopping = !running.load(std::memory_order_acquire);
+			SoundEvent event;
+			while (ring.pop(event)) {
+				postedCount.fetch_add(1, std::memory_order_relaxed);
+				if (event.id >= SOUND_COUNT)
+					continue;
+				Pending& p = pending[event.id];
+				p.count++;
+				p.gain = std::max(p.gain, event.gain);
+				p.positionSum += event.position;
+			}
+
+			Clock::time_point now = Clock::now();
+			for (unsigned short id = 0; id < SOUND_COUNT; id++) {
+				Pending& p = pending[id];
+				if (p.count == 0 || now - lastPlayed[id] < std::chrono::milliseconds(minIntervalMs))
+					continue;
+				SoundEvent merged;
+				merged.id = id;
+				merged.gain = std::min(1.0f, p.gain * (1.0f + 0.1f * (p.count - 1)));
+				merged.position = p.positionSum / (float)p.count;
+				if (play)
+					play(merged);
+				playedCount.fetch_add(1, std::memory_order_relaxed);
+				lastPlayed[id] = now;
+				clear(p);
+			}
+
+			if (stopping)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+};
+#endif
@@ -0,0 +1,283 @@
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include "logging.h"
+
+#ifdef __linux__
+#if defined(__has_include)
+#if __has_include(<alsa/asoundlib.h>)
+#define AUDIO_ALSA 1
+#include <alsa/asoundlib.h>
+#endif
+#endif
+#endif
+#ifdef _WIN32
+#define AUDIO_WINMM 1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef NOGDI
+#define NOGDI
+#endif
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// Where the mixer's 16 bit interleaved samples go. write() blocks until the
+// output has room for the buffer, so it paces the mixer thread the way a
+// device callback would.
+class AudioOutput {
+public:
+	virtual ~AudioOutput() {}
+	virtual bool open(unsigned int sampleRate, unsigned int channels, unsigned int framesPerBuffer) = 0;
+	virtual bool write(const short* samples, unsigned int frames) = 0;
+	virtual void close() = 0;
+	// times the device ran dry before the next buffer arrived
+	virtual unsigned int underruns() const { return 0; }
+};
+
+// Writes everything to a 16 bit PCM WAVE file, for tests and machines without
+// a sound device. In realtime mode write() waits until the buffer would have
+// been played, so a running game fills the file at the speed it plays.
+class WavFileOutput : public AudioOutput {
+public:
+	WavFileOutput(const std::string& path, bool realtime) : path(path), realtime(realtime) {}
+	~WavFileOutput() { close(); }
+
+	bool open(unsigned int sampleRate, unsigned int channels, unsigned int) override
+	{
+		rate = sampleRate;
+		channelCount = channels;
+		file.open(path, std::ios::binary);
+		if (!file) {
+			LOG_ERROR(SOUND, "could not write %s", path.c_str());
+			return false;
+		}
+		writeHeader();
+		start = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	bool write(const short* samples, unsigned int frames) override
+	{
+		bytes.resize(frames * channelCount * 2); // same size every buffer, so allocated once
+		for (unsigned int i = 0; i < frames * channelCount; i++) {
+			bytes[i * 2] = (unsigned char)(samples[i] & 0xFF);
+			bytes[i * 2 + 1] = (unsigned char)((samples[i] >> 8) & 0xFF);
+		}
+		file.write((const char*)bytes.data(), bytes.size());
+		framesWritten += frames;
+		if (realtime)
+			std::this_thread::sleep_until(start + std::chrono::microseconds(framesWritten * 1000000 / rate));
+		return (bool)file;
+	}
+
+	void close() override
+	{
+		if (!file.is_open())
+			return;
+		// sizes are only known now
+		file.seekp(0);
+		writeHeader();
+		file.close();
+	}
+
+private:
+	std::string path;
+	bool realtime;
+	unsigned int rate = 0, channelCount = 0;
+	std::vector<unsigned char> bytes;
+	unsigned long long framesWritten = 0;
+	std::chrono::steady_clock::time_point start;
+	std::ofstream file;
+
+	void writeHeader()
+	{
+		unsigned int dataBytes = (unsigned int)(framesWritten * channelCount * 2);
+		unsigned char header[44];
+		unsigned int at = 0;
+		auto put = [&](unsigned int value, int size) {
+			for (int i = 0; i < size; i++)
+				header[at++] = (unsigned char)(value >> (8 * i));
+		};
+		auto tag = [&](const char* text) {
+			for (int i = 0; i < 4; i++)
+				header[at++] = (unsigned char)text[i];
+		};
+		tag("RIFF"); put(36 + dataBytes, 4); tag("WAVE");
+		tag("fmt "); put(16, 4); put(1, 2); put(channelCount, 2); put(rate, 4);
+		put(rate * channelCount * 2, 4); put(channelCount * 2, 2); put(16, 2);
+		tag("data"); put(dataBytes, 4);
+		file.write((const char*)header, sizeof(header));
+	}
+};
+
+#ifdef AUDIO_ALSA
+// The default ALSA PCM device (link with -lasound)
+class AlsaOutput : public AudioOutput {
+public:
+	~AlsaOutput() { close(); }
+
+	bool open(unsigned int sampleRate, unsigned int channels, unsigned int framesPerBuffer) override
+	{
+		channelCount = channels;
+		int error = snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0);
+		if (error < 0) {
+			LOG_ERROR(SOUND, "no ALSA device: %s", snd_strerror(error));
+			pcm = nullptr;
+			return false;
+		}
+		// three buffers of latency
+		unsigned int latencyUs = (unsigned int)(3ull * framesPerBuffer * 1000000 / sampleRate);
+		error = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, channels, sampleRate, 1, latencyUs);
+		if (error < 0) {
+			LOG_ERROR(SOUND, "ALSA refused the format: %s", snd_strerror(error));
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	bool write(const short* samples, unsigned int frames) override
+	{
+		while (frames > 0) {
+			snd_pcm_sframes_t written = snd_pcm_writei(pcm, samples, frames);
+			if (written == -EPIPE) {
+				underrunCount++;
+				snd_pcm_prepare(pcm);
+				continue;
+			}
+			if (written < 0) {
+				if (snd_pcm_recover(pcm, (int)written, 1) < 0)
+					return false;
+				continue;
+			}
+			samples += written * channelCount;
+			frames -= (unsigned int)written;
+		}
+		return true;
+	}
+
+	void close() override
+	{
+		if (!pcm)
+			return;
+		snd_pcm_drop(pcm);
+		snd_pcm_close(pcm);
+		pcm = nullptr;
+	}
+
+	unsigned int underruns() const override { return underrunCount; }
+
+private:
+	snd_pcm_t* pcm = nullptr;
+	unsigned int channelCount = 0;
+	unsigned int underrunCount = 0;
+};
+#endif
+
+#ifdef AUDIO_WINMM
+// The default waveOut device, fed from a small ring of buffers
+class WaveOutOutput : public AudioOutput {
+public:
+	~WaveOutOutput() { close(); }
+
+	bool open(unsigned int sampleRate, unsigned int channels, unsigned int framesPerBuffer) override
+	{
+		WAVEFORMATEX format = {};
+		format.wFormatTag = WAVE_FORMAT_PCM;
+		format.nChannels = (WORD)channels;
+		format.nSamplesPerSec = sampleRate;
+		format.wBitsPerSample = 16;
+		format.nBlockAlign = (WORD)(channels * 2);
+		format.nAvgBytesPerSec = sampleRate * format.nBlockAlign;
+		if (waveOutOpen(&device, WAVE_MAPPER, &format, 0, 0, CALLBACK_NULL) != MMSYSERR_NOERROR) {
+			LOG_ERROR(SOUND, "no waveOut device");
+			device = nullptr;
+			return false;
+		}
+		channelCount = channels;
+		for (unsigned int i = 0; i < BUFFERS; i++) {
+			storage[i].assign(framesPerBuffer * channels, 0);
+			headers[i] = WAVEHDR();
+			headers[i].lpData = (LPSTR)storage[i].data();
+			headers[i].dwBufferLength = (DWORD)(storage[i].size() * sizeof(short));
+			waveOutPrepareHeader(device, &headers[i], sizeof(WAVEHDR));
+			// prepared and never queued counts as played
+			headers[i].dwFlags |= WHDR_DONE;
+		}
+		return true;
+	}
+
+	bool write(const short* samples, unsigned int frames) override
+	{
+		WAVEHDR& header = headers[next];
+		while (!(header.dwFlags & WHDR_DONE))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		// every buffer played out means the device went silent waiting for us
+		bool dry = true;
+		for (unsigned int i = 0; i < BUFFERS; i++)
+			dry = dry && (headers[i].dwFlags & WHDR_DONE);
+		if (dry && started)
+			underrunCount++;
+		unsigned int samplesToCopy = std::min((unsigned int)storage[next].size(), frames * channelCount);
+		std::copy(samples, samples + samplesToCopy, storage[next].begin());
+		header.dwBufferLength = samplesToCopy * sizeof(short);
+		header.dwFlags &= ~WHDR_DONE;
+		if (waveOutWrite(device, &header, sizeof(WAVEHDR)) != MMSYSERR_NOERROR)
+			return false;
+		started = true;
+		next = (next + 1) % BUFFERS;
+		return true;
+	}
+
+	void close() override
+	{
+		if (!device)
+			return;
+		waveOutReset(device);
+		for (unsigned int i = 0; i < BUFFERS; i++)
+			waveOutUnprepareHeader(device, &headers[i], sizeof(WAVEHDR));
+		waveOutClose(device);
+		device = nullptr;
+	}
+
+	unsigned int underruns() const override { return underrunCount; }
+
+private:
+	enum : unsigned int { BUFFERS = 3 };
+
+	HWAVEOUT device = nullptr;
+	WAVEHDR headers[BUFFERS];
+	std::vector<short> storage[BUFFERS];
+	unsigned int channelCount = 0;
+	unsigned int next = 0;
+	bool started = false;
+	unsigned int underrunCount = 0;
+};
+#endif
+
+// The platform's sound device, or null where this build has none
+inline AudioOutput* createDeviceOutput()
+{
+#if defined(AUDIO_WINMM)
+	return new WaveOutOutput();
+#elif defined(AUDIO_ALSA)
+	return new AlsaOutput();
+#else
+	return nullptr;
+#endif
+}
+#endif
@@ -0,0 +1,89 @@
+#ifndef BALANCE_H
+#define BALANCE_H
+
+#include "game.h"
+#include "controllers.h"
+#include "options.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+// --balance LEVELS: plays that many levels as fast as the machine allows, on
+// simulated time only, with a plate controller in place of the player, and
+// prints what happened at each level. Food speed, spawn delay and the level
+// curve come from the command line, so a tuning change can be judged in
+// seconds instead of a play session. Returns the exit code, 1 if the food pool
+// ran full.
+inline int runBalance(const AppOptions& options)
+{
+	Game game(options.hasSeed ? options.seed : std::random_device()());
+	game.trackPairs = false;
+	if (options.delay > 0.0f) game.delay = options.delay;
+	if (options.foodSpeed > 0.0f) game.foodSpeed = options.foodSpeed;
+	if (options.levelSeconds > 0.0f) game.increaseDifficulty = options.levelSeconds;
+	if (options.speedStep >= 0.0f) game.speedStep = options.speedStep;
+	if (options.delayStep >= 0.0f) game.delayStep = options.delayStep;
+
+	struct LevelStats {
+		float foodSpeed, delay;
+		int spawned, collected, missed;
+	};
+	std::vector<LevelStats> levels(1, LevelStats{ game.foodSpeed, game.delay, 0, 0, 0 });
+	const float dt = 1.0f / options.tickRate;
+	GameInput input;
+	unsigned int maxLive = 0;
+	int spawned = game.numberOfObject, collected = 0, missed = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (game.level <= options.balanceLevels) {
+		if (options.controller == "chase")
+			chaseInput(game, input);
+		else if (options.controller == "planner")
+			plannerInput(game, input);
+		else if (options.controller == "sweep")
+			scriptedInput(game.time, game.platePosition.x, input);
+		else
+			input.plateDirection = 0;
+
+		game.tick(dt, input);
+
+		// everything that happened this tick counts for the level it ended in
+		if ((int)levels.size() < game.level)
+			levels.push_back(LevelStats{ game.foodSpeed, game.delay, 0, 0, 0 });
+		LevelStats& stats = levels[game.level - 1];
+		stats.spawned += game.numberOfObject - spawned;
+		stats.collected += game.numberOfCollisions - collected;
+		stats.missed += game.numberMissed - missed;
+		spawned = game.numberOfObject;
+		collected = game.numberOfCollisions;
+		missed = game.numberMissed;
+		maxLive = std::max(maxLive, game.foods.size());
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "level  speed  delay  spawned  collected  missed  caught" << std::endl;
+	std::cout << std::fixed;
+	for (unsigned int l = 0; l < levels.size() && (int)l < options.balanceLevels; l++) {
+		const LevelStats& s = levels[l];
+		int resolved = s.collected + s.missed;
+		std::cout << std::setw(5) << l + 1 << std::setprecision(3) << std::setw(7) << s.foodSpeed << std::setw(7) << s.delay
+			<< std::setw(9) << s.spawned << std::setw(11) << s.collected << std::setw(8) << s.missed
+			<< std::setprecision(1) << std::setw(7) << (resolved ? 100.0 * s.collected / resolved : 0.0) << "%" << std::endl;
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+	std::cout << "controller " << options.controller << ": collected " << game.numberOfCollisions << ", missed " << game.numberMissed
+		<< " of " << game.numberOfObject << " spawned, at most " << maxLive << " foods live" << std::endl;
+	std::cout << game.ticks << " ticks of " << dt * 1000.0f << " ms in " << seconds << " s, "
+		<< (seconds > 0.0 ? game.ticks / seconds : 0.0) << " ticks/s" << std::endl;
+	// the numbers above are not the tuning's when spawns were skipped
+	if (maxLive >= game.foods.capacity()) {
+		std::cout << "ERROR::BALANCE: food pool ran full, spawns were skipped" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+#endif
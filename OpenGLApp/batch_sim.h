@@ -0,0 +1,219 @@
+#ifndef BATCH_SIM_H
+#define BATCH_SIM_H
+
+#include "game.h"
+#include "job_system.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+// Many independent games stepped in lockstep, for training plate controllers.
+// Every session follows the rules of Game::tick with the default collision
+// boxes, but the state of all sessions is kept as one array per field: the
+// scalars indexed by session, the foods in a fixed slice of foodsPerSession
+// slots per session. A step runs the sessions in chunks on a JobSystem.
+//
+//   BatchSim sim(4096, 1234);
+//   sim.step(actions, observations, rewards);
+//
+// actions holds one plate direction (-1, 0, 1) per session, observations gets
+// OBSERVATION_SIZE floats per session and rewards one float per session.
+class BatchSim {
+public:
+	enum : unsigned int {
+		OBSERVED_FOODS = 4,                             // lowest foods in play, nearest first
+		OBSERVATION_SIZE = 3 + OBSERVED_FOODS * 2,      // plate x, plate direction, food speed, then x, y per food
+	};
+
+	// defaults of a new Game
+	float dt = 1.0f / 60.0f;
+	float plateSpeed = 1.8f;
+	float firstFoodSpeed = 0.42f;
+	float firstDelay = 2.0f;
+	float increaseDifficulty = 6.0f;
+	float speedStep = 0.18f;
+	float delayStep = 0.5f;
+	float collectReward = 1.0f;
+	float missReward = -1.0f;
+
+	// session i is seeded with seed + i; threads 0 means one per core
+	BatchSim(unsigned int sessions, unsigned int seed, unsigned int foodsPerSession = 64, unsigned int threads = 0)
+		: sessions(sessions), capacity(foodsPerSession), jobs(threads),
+		plateX(sessions), previousPlateX(sessions), plateDirection(sessions), foodSpeed(sessions), delay(sessions),
+		time(sessions), pastTime(sessions), pastDifficulty(sessions), level(sessions),
+		collected(sessions), missed(sessions), spawned(sessions), foodCount(sessions),
+		x(sessions * foodsPerSession), y(sessions * foodsPerSession), z(sessions * foodsPerSession), prevY(sessions * foodsPerSession),
+		halfX(sessions * foodsPerSession), lowY(sessions * foodsPerSession), highY(sessions * foodsPerSession), halfZ(sessions * foodsPerSession),
+		type(sessions * foodsPerSession), hits(sessions * foodsPerSession),
+		rng(sessions)
+	{
+		CollisionShape box;
+		for (int t = 0; t < 3; t++)
+			extents[t] = spinningExtents(box);
+		plateBox = box;
+		for (unsigned int s = 0; s < sessions; s++)
+			reset(s, seed + s);
+	}
+
+	unsigned int size() const { return sessions; }
+	unsigned int threads() const { return jobs.threads(); }
+
+	// starts session s over, as a new Game(seed) would
+	void reset(unsigned int s, unsigned int seed) {
+		rng[s].seed(seed);
+		plateX[s] = previousPlateX[s] = 0.0f;
+		plateDirection[s] = 0;
+		foodSpeed[s] = firstFoodSpeed;
+		delay[s] = firstDelay;
+		time[s] = pastTime[s] = pastDifficulty[s] = 0.0;
+		level[s] = 1;
+		collected[s] = missed[s] = spawned[s] = 0;
+		foodCount[s] = 0;
+		spawn(s);
+	}
+
+	// one tick of every session; rewards are for what happened in this tick
+	void step(const int* actions, float* observations, float* rewards) {
+		jobs.parallelFor(sessions, GRAIN, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int s = begin; s < end; s++) {
+				int collectedBefore = collected[s], missedBefore = missed[s];
+				tick(s, actions[s]);
+				rewards[s] = (collected[s] - collectedBefore) * collectReward + (missed[s] - missedBefore) * missReward;
+				observe(s, observations + s * OBSERVATION_SIZE);
+			}
+		});
+	}
+
+	// plain observations without stepping, e.g. right after construction
+	void observeAll(float* observations) const {
+		for (unsigned int s = 0; s < sessions; s++)
+			observe(s, observations + s * OBSERVATION_SIZE);
+	}
+
+	// per-session state, for statistics and checks
+	int collectedCount(unsigned int s) const { return collected[s]; }
+	int missedCount(unsigned int s) const { return missed[s]; }
+	int spawnedCount(unsigned int s) const { return spawned[s]; }
+	int levelOf(unsigned int s) const { return level[s]; }
+	float plate(unsigned int s) const { return plateX[s]; }
+	unsigned int foods(unsigned int s) const { return foodCount[s]; }
+	glm::vec3 food(unsigned int s, unsigned int i) const { unsigned int k = s * capacity + i; return glm::vec3(x[k], y[k], z[k]); }
+
+private:
+	enum : unsigned int { GRAIN = 64 };
+
+	unsigned int sessions, capacity;
+	JobSystem jobs;
+	FoodExtents extents[3];
+	CollisionShape plateBox;
+
+	// per session
+	std::vector<float> plateX, previousPlateX;
+	std::vector<int> plateDirection;
+	std::vector<float> foodSpeed, delay;
+	std::vector<double> time, pastTime, pastDifficulty;
+	std::vector<int> level, collected, missed, spawned;
+	std::vector<unsigned int> foodCount;
+	// per food slot, capacity slots per session
+	std::vector<float> x, y, z, prevY;
+	std::vector<float> halfX, lowY, highY, halfZ;
+	std::vector<int> type;
+	std::vector<unsigned char> hits;
+	std::vector<std::mt19937> rng;
+
+	FoodArrays arrays(unsigned int s) {
+		unsigned int k = s * capacity;
+		return FoodArrays{ &x[k], &y[k], &z[k], &prevY[k], &halfX[k], &lowY[k], &highY[k], &halfZ[k] };
+	}
+
+	void spawn(unsigned int s) {
+		if (foodCount[s] == capacity)
+			return;
+		glm::vec3 position = generateRandomPosition(rng[s]);
+		int t = generateRandomObject(rng[s]);
+		unsigned int k = s * capacity + foodCount[s]++;
+		x[k] = position.x;
+		y[k] = prevY[k] = position.y;
+		z[k] = position.z;
+		halfX[k] = extents[t].halfX;
+		lowY[k] = extents[t].lowY;
+		highY[k] = extents[t].highY;
+		halfZ[k] = extents[t].halfZ;
+		type[k] = t;
+		hits[k] = 0;
+		spawned[s]++;
+	}
+
+	void remove(unsigned int s, unsigned int i) {
+		unsigned int k = s * capacity + i, last = s * capacity + --foodCount[s];
+		x[k] = x[last]; y[k] = y[last]; z[k] = z[last]; prevY[k] = prevY[last];
+		halfX[k] = halfX[last]; lowY[k] = lowY[last]; highY[k] = highY[last]; halfZ[k] = halfZ[last];
+		type[k] = type[last];
+		hits[k] = hits[last];
+	}
+
+	// Game::tick for session s, step for step
+	void tick(unsigned int s, int direction) {
+		unsigned int base = s * capacity;
+		for (unsigned int i = foodCount[s]; i > 0; i--) {
+			if (y[base + i - 1] <= -1.10f) {
+				if (!hits[base + i - 1])
+					missed[s]++;
+				remove(s, i - 1);
+			}
+		}
+		previousPlateX[s] = plateX[s];
+		time[s] += dt;
+
+		for (int n = advanceLevel(time[s], increaseDifficulty, speedStep, delayStep, level[s], pastDifficulty[s], foodSpeed[s], delay[s], pastTime[s]); n > 0; n--)
+			spawn(s);
+
+		plateDirection[s] = direction;
+		plateX[s] += direction * plateSpeed * dt;
+		plateX[s] = glm::clamp(plateX[s], -0.45f, 0.45f);
+
+		unsigned int n = foodCount[s];
+		float dy = foodSpeed[s] * dt;
+		float plateDx = plateX[s] - previousPlateX[s];
+		AABB plateStart = plateBox.at(glm::vec3(previousPlateX[s], -1.10f, 0.0f));
+		unsigned int hitCount = stepFoods(arrays(s), n, dy, plateStart, plateDx, &hits[base]);
+		for (unsigned int i = 0; hitCount > 0 && i < n; i++) {
+			if (!hits[base + i])
+				continue;
+			hitCount--;
+			y[base + i] = prevY[base + i] = -10.0f;
+			collected[s]++;
+		}
+	}
+
+	void observe(unsigned int s, float* out) const {
+		out[0] = plateX[s];
+		out[1] = (float)plateDirection[s];
+		out[2] = foodSpeed[s];
+		// insertion into a short list of the lowest foods still falling; empty entries sit high above the belt
+		float fx[OBSERVED_FOODS], fy[OBSERVED_FOODS];
+		for (unsigned int k = 0; k < OBSERVED_FOODS; k++) {
+			fx[k] = 0.0f;
+			fy[k] = 2.0f;
+		}
+		unsigned int base = s * capacity;
+		for (unsigned int i = 0; i < foodCount[s]; i++) {
+			float fyi = y[base + i];
+			if (fyi <= -1.10f || fyi >= fy[OBSERVED_FOODS - 1])
+				continue;
+			unsigned int k = OBSERVED_FOODS - 1;
+			for (; k > 0 && fy[k - 1] > fyi; k--) {
+				fx[k] = fx[k - 1];
+				fy[k] = fy[k - 1];
+			}
+			fx[k] = x[base + i];
+			fy[k] = fyi;
+		}
+		for (unsigned int k = 0; k < OBSERVED_FOODS; k++) {
+			out[3 + k * 2] = fx[k];
+			out[4 + k * 2] = fy[k];
+		}
+	}
+};
+#endif
@@ -0,0 +1,422 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "game.h"
+#include "food_kernels.h"
+#include "batch_sim.h"
+#include "job_system.h"
+#include "voice_pool.h"
+#include "mixer.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+// The SIMD kernels (food_kernels.h, mixer_kernels.h) evaluate the very same
+// float expressions in the same order as their scalar versions, so they must
+// give bit-identical results, not merely close ones. --bench-soa and
+// --bench-audio run every variant the build has against the scalar one and
+// fail on any difference.
+
+// --bench-soa: the food step (fall + swept plate test) as the render loop used
+// to do it, one AoS Food at a time through createAABB/timeOfImpact, against the
+// SoA kernels. Every variant starts from the same foods and must report the
+// same number of hits.
+inline int runSoaBench()
+{
+	struct OldFood {
+		glm::vec3 position;
+		int type;
+	};
+	typedef std::chrono::steady_clock Clock;
+	const glm::vec3 platePosition(0.0f, -1.10f, 0.0f);
+	const AABB plate = createAABB(platePosition);
+	const unsigned int counts[] = { 1000, 100000, 1000000 };
+	bool ok = true;
+
+	std::cout << std::fixed << std::setprecision(3);
+	for (unsigned int c = 0; c < 3; c++) {
+		unsigned int n = counts[c];
+		// about 50 million food steps per variant, falling the height of the belt over all of them
+		unsigned int reps = 50000000 / n;
+		const float dy = 2.3f / reps;
+
+		std::mt19937 gen(1234);
+		std::uniform_int_distribution<int> lane(0, 2);
+		std::uniform_real_distribution<float> height(-1.10f, 1.20f);
+		const float lanes[3] = { -0.50f, 0.0f, 0.50f };
+		std::vector<OldFood> aos(n);
+		std::vector<float> x(n), y(n), z(n), prevY(n), startY(n);
+		// every food with the box createAABB makes
+		std::vector<float> halfX(n, 0.1f), lowY(n, -0.1f), highY(n, 0.1f), halfZ(n, 0.01f);
+		FoodArrays arrays = { x.data(), y.data(), z.data(), prevY.data(), halfX.data(), lowY.data(), highY.data(), halfZ.data() };
+		std::vector<unsigned char> hits(n);
+		for (unsigned int i = 0; i < n; i++) {
+			aos[i].position = glm::vec3(lanes[lane(gen)], height(gen), 0.0f);
+			aos[i].type = 0;
+			x[i] = aos[i].position.x;
+			z[i] = aos[i].position.z;
+			startY[i] = aos[i].position.y;
+		}
+
+		// the old per-object loop
+		unsigned long long aosHits = 0;
+		Clock::time_point start = Clock::now();
+		for (unsigned int r = 0; r < reps; r++) {
+			for (unsigned int i = 0; i < n; i++) {
+				AABB objectAABB = createAABB(aos[i].position);
+				AABB plateAABB = createAABB(platePosition);
+				aos[i].position.y -= dy;
+				if (timeOfImpact(objectAABB, glm::vec3(0.0f, -dy, 0.0f), plateAABB, glm::vec3(0.0f)) >= 0.0f)
+					aosHits++;
+			}
+		}
+		double aosNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ((double)n * reps);
+
+		struct Kernel {
+			const char* name;
+			unsigned int(*step)(const FoodArrays&, unsigned int, unsigned int, float, const AABB&, float, unsigned char*);
+		};
+		std::vector<Kernel> kernels;
+		kernels.push_back(Kernel{ "SoA scalar", stepFoodsScalar });
+#ifdef SIMD_SSE2
+		kernels.push_back(Kernel{ "SoA SSE", stepFoodsSSE });
+#endif
+#ifdef SIMD_AVX2
+		kernels.push_back(Kernel{ "SoA AVX2", stepFoodsAVX2 });
+#endif
+
+		std::cout << n << " foods, " << reps << " steps" << std::endl;
+		std::cout << "  " << std::setw(12) << std::left << "AoS" << std::right << aosNs << " ns/food" << std::endl;
+		std::vector<float> referenceY;
+		std::vector<unsigned char> referenceHits;
+		for (unsigned int k = 0; k < kernels.size(); k++) {
+			y = startY;
+			unsigned long long kernelHits = 0;
+			start = Clock::now();
+			for (unsigned int r = 0; r < reps; r++)
+				kernelHits += kernels[k].step(arrays, 0, n, dy, plate, 0.0f, hits.data());
+			double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ((double)n * reps);
+			std::cout << "  " << std::setw(12) << std::left << kernels[k].name << std::right << ns << " ns/food  "
+				<< aosNs / ns << "x";
+			if (kernelHits != aosHits) {
+				std::cout << "  MISMATCH: " << kernelHits << " hits, AoS had " << aosHits;
+				ok = false;
+			}
+			if (k == 0) {
+				referenceY = y;
+				referenceHits = hits;
+			}
+			else if (y != referenceY || hits != referenceHits) {
+				std::cout << "  MISMATCH: differs from SoA scalar";
+				ok = false;
+			}
+			std::cout << std::endl;
+		}
+	}
+	std::cout << std::defaultfloat;
+	return ok ? 0 : 1;
+}
+
+// --bench-batch SESSIONS: first plays a few BatchSim sessions next to Games
+// seeded the same and fed the same actions, which must end up identical, then
+// times a full batch at 1, 2, 4... threads up to one per core.
+inline int runBatchBench(unsigned int sessions)
+{
+	typedef std::chrono::steady_clock Clock;
+	bool ok = true;
+
+	{
+		// enough sessions for several chunks, on more threads than sessions need
+		const unsigned int n = 200, seed = 77;
+		BatchSim batch(n, seed, 64, 4);
+		std::vector<Game*> games;
+		for (unsigned int s = 0; s < n; s++) {
+			games.push_back(new Game(seed + s));
+			games.back()->trackPairs = false;
+		}
+		std::mt19937 gen(5);
+		std::uniform_int_distribution<int> action(-1, 1);
+		std::vector<int> actions(n);
+		std::vector<float> observations(n * BatchSim::OBSERVATION_SIZE), rewards(n);
+		unsigned int mismatches = 0;
+		// four minutes: past level 31, where the spawn delay reaches its floor
+		const int ticks = 60 * 240;
+		for (int t = 0; t < ticks; t++) {
+			for (unsigned int s = 0; s < n; s++)
+				actions[s] = action(gen);
+			batch.step(actions.data(), observations.data(), rewards.data());
+			for (unsigned int s = 0; s < n; s++) {
+				GameInput input;
+				input.plateDirection = actions[s];
+				Game& game = *games[s];
+				game.tick(batch.dt, input);
+				bool same = game.numberOfCollisions == batch.collectedCount(s) && game.numberMissed == batch.missedCount(s) &&
+					game.numberOfObject == batch.spawnedCount(s) && game.level == batch.levelOf(s) &&
+					game.platePosition.x == batch.plate(s) && game.foods.size() == batch.foods(s);
+				for (unsigned int i = 0; same && i < game.foods.size(); i++)
+					same = game.foods.get(i).position == batch.food(s, i);
+				mismatches += !same;
+			}
+		}
+		int collected = 0, missed = 0;
+		for (unsigned int s = 0; s < n; s++) {
+			collected += batch.collectedCount(s);
+			missed += batch.missedCount(s);
+			delete games[s];
+		}
+		std::cout << n << " sessions against Game over " << ticks << " ticks: " << collected << " collected, " << missed << " missed, "
+			<< mismatches << " mismatching states" << std::endl;
+		ok = mismatches == 0;
+	}
+
+	const int steps = 2000;
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	double single = 0.0;
+	std::cout << std::fixed << std::setprecision(2);
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < cores; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(cores);
+	for (unsigned int c = 0; c < threadCounts.size(); c++) {
+		unsigned int threads = threadCounts[c];
+		BatchSim batch(sessions, 1, 64, threads);
+		std::vector<int> actions(sessions);
+		std::vector<float> observations(sessions * BatchSim::OBSERVATION_SIZE), rewards(sessions);
+		batch.observeAll(observations.data());
+		Clock::time_point start = Clock::now();
+		for (int t = 0; t < steps; t++) {
+			// every session steers for its lowest food, as chaseInput would
+			for (unsigned int s = 0; s < sessions; s++) {
+				const float* o = &observations[s * BatchSim::OBSERVATION_SIZE];
+				actions[s] = o[4] < 2.0f ? (o[3] > o[0] + 0.03f ? 1 : o[3] < o[0] - 0.03f ? -1 : 0) : 0;
+			}
+			batch.step(actions.data(), observations.data(), rewards.data());
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		double rate = sessions * (double)steps / seconds;
+		if (threads == 1)
+			single = rate;
+		std::cout << std::setw(3) << threads << " threads: " << std::setw(8) << rate / 1e6 << " M session steps/s, "
+			<< rate / single << "x" << std::endl;
+	}
+	std::cout << std::defaultfloat;
+	return ok ? 0 : 1;
+}
+
+// --bench-jobs: checks that parallelFor covers every index once and that
+// runAfter waits for its dependency, then measures what a job costs to
+// schedule and how a compute-bound loop scales from 1 thread up to one per
+// hardware thread.
+inline int runJobBench()
+{
+	typedef std::chrono::steady_clock Clock;
+	bool ok = true;
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+
+	{
+		// more threads than this machine may have, so stealing happens either way
+		JobSystem jobs(4);
+		std::vector<unsigned char> seen(1000003, 0);
+		jobs.parallelFor((unsigned int)seen.size(), 1000, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int i = begin; i < end; i++)
+				seen[i]++;
+		});
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < seen.size(); i++)
+			wrong += seen[i] != 1;
+
+		JobCounter first, second;
+		std::atomic<int> stage{ 0 };
+		std::atomic<int> early{ 0 };
+		for (int i = 0; i < 64; i++)
+			jobs.run([&] { std::this_thread::sleep_for(std::chrono::microseconds(50)); stage.fetch_add(1); }, &first);
+		for (int i = 0; i < 16; i++)
+			jobs.runAfter(first, [&] { if (stage.load() != 64) early.fetch_add(1); }, &second);
+		jobs.wait(second);
+		std::cout << "parallelFor: " << wrong << " indices not run exactly once; runAfter: " << early.load() << " of 16 started early" << std::endl;
+		ok = wrong == 0 && early.load() == 0;
+	}
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < cores; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(cores);
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "threads  ns/run()  ns/chunk  compute ms  speedup" << std::endl;
+	const unsigned int elements = 1 << 22;
+	std::vector<float> data(elements, 1.0f);
+	double single = 0.0;
+	for (unsigned int c = 0; c < threadCounts.size(); c++) {
+		JobSystem jobs(threadCounts[c]);
+
+		// overhead of single small jobs, from queueing to the last one finished
+		const int jobCount = 100000;
+		std::atomic<int> ran{ 0 };
+		JobCounter counter;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < jobCount; i++)
+			jobs.run([&ran] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		jobs.wait(counter);
+		double runNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / jobCount;
+
+		// overhead of parallelFor chunks with an empty body
+		const unsigned int chunks = 1000000;
+		start = Clock::now();
+		jobs.parallelFor(chunks, 1, [](unsigned int, unsigned int) {});
+		double chunkNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / chunks;
+
+		// compute-bound loop, ten passes over 4M floats
+		start = Clock::now();
+		for (int pass = 0; pass < 10; pass++) {
+			jobs.parallelFor(elements, 16384, [&](unsigned int begin, unsigned int end) {
+				for (unsigned int i = begin; i < end; i++)
+					data[i] = std::sqrt(data[i] * 1.0001f + 0.5f);
+			});
+		}
+		double computeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (c == 0)
+			single = computeMs;
+		std::cout << std::setw(7) << threadCounts[c] << std::setw(10) << runNs << std::setw(10) << chunkNs
+			<< std::setw(12) << computeMs << std::setw(8) << single / computeMs << "x" << std::endl;
+	}
+	std::cout << std::defaultfloat;
+	return ok ? 0 : 1;
+}
+
+// --bench-audio: decodes the sound bank, checks voice stealing on the null
+// backend with a manual clock, then measures what VoicePool::play costs with
+// every voice busy. The mixer kernels are checked against each other and
+// timed, and two seconds of busy gameplay audio, music streamed from disk
+// included, are mixed in real time into audio_bench.wav.
+inline int runAudioBench()
+{
+	typedef std::chrono::steady_clock Clock;
+	SoundBank bank;
+	Clock::time_point start = Clock::now();
+	if (!loadGameSounds(bank))
+		return 1;
+	double decodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	std::cout << "Decoded " << SOUND_COUNT << " sounds, " << bank.bytes() / 1024 << " KiB, in " << decodeMs << " ms" << std::endl;
+	for (unsigned short id = 0; id < SOUND_COUNT; id++) {
+		const SoundClip& clip = bank.clip(id);
+		std::cout << "  sound " << id << ": " << clip.channels << " ch, " << clip.sampleRate << " Hz, " << clip.seconds() << " s" << std::endl;
+	}
+
+	bool ok = true;
+	{
+		NullAudioBackend backend;
+		for (unsigned short id = 0; id < SOUND_COUNT; id++)
+			backend.upload(id, bank.clip(id));
+		backend.advance(0.0);
+		VoicePool voices(backend, bank, 4);
+		SoundEvent wall = { SOUND_WALL, 1.0f, glm::vec3(0.0f) };
+		SoundEvent pickup = { SOUND_PICKUP, 1.0f, glm::vec3(0.0f) };
+		bool filled = true;
+		for (int i = 0; i < 4; i++)
+			filled = voices.play(wall) && filled;
+		// pickups outrank the wall and take its voices, oldest first
+		bool stole = true;
+		for (int i = 0; i < 4; i++)
+			stole = voices.play(pickup) && stole;
+		// nothing lower may take a pickup's voice, an equal one takes the oldest
+		bool refused = !voices.play(wall);
+		bool replaced = voices.play(pickup);
+		// once the clips have ended every voice is free again
+		backend.advance(bank.clip(SOUND_PICKUP).seconds() + 0.01);
+		bool freed = voices.busy() == 0 && voices.play(wall);
+		ok = filled && stole && refused && replaced && freed && voices.stolen() == 5 && voices.rejected() == 1;
+		std::cout << "Voice stealing: " << (ok ? "ok" : "FAILED") << " (played " << voices.played() << ", stolen " << voices.stolen()
+			<< ", rejected " << voices.rejected() << ")" << std::endl;
+	}
+
+	{
+		NullAudioBackend backend;
+		for (unsigned short id = 0; id < SOUND_COUNT; id++)
+			backend.upload(id, bank.clip(id));
+		VoicePool voices(backend, bank, 32);
+		std::mt19937 rng(1234);
+		const int plays = 1000000;
+		start = Clock::now();
+		for (int i = 0; i < plays; i++) {
+			backend.advance(0.0005);
+			SoundEvent event = { (unsigned short)(rng() % SOUND_COUNT), 1.0f, glm::vec3(0.0f) };
+			voices.play(event);
+		}
+		double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / plays;
+		std::cout << "VoicePool::play, 32 voices: " << ns << " ns (stolen " << voices.stolen() << ", rejected " << voices.rejected() << ")" << std::endl;
+	}
+
+	{
+		// 32 voices of 512 frames, mono and stereo, through every kernel this build has
+		const unsigned int frames = 512, voiceCount = 32, passes = 2000;
+		std::mt19937 rng(99);
+		std::vector<short> input(frames * 2 * voiceCount);
+		for (unsigned int i = 0; i < input.size(); i++)
+			input[i] = (short)(rng() & 0xFFFF);
+		typedef void (*Kernel)(float*, const short*, unsigned int, unsigned int, float, float);
+		struct Variant { const char* name; Kernel kernel; };
+		std::vector<Variant> variants;
+		variants.push_back(Variant{ "scalar", &mixVoiceScalar });
+#ifdef SIMD_SSE2
+		variants.push_back(Variant{ "SSE2", &mixVoiceSSE });
+#endif
+#ifdef SIMD_AVX2
+		variants.push_back(Variant{ "AVX2", &mixVoiceAVX2 });
+#endif
+		std::vector<float> reference;
+		for (unsigned int k = 0; k < variants.size(); k++) {
+			std::vector<float> out(frames * 2);
+			start = Clock::now();
+			for (unsigned int pass = 0; pass < passes; pass++) {
+				std::fill(out.begin(), out.end(), 0.0f);
+				for (unsigned int v = 0; v < voiceCount; v++)
+					variants[k].kernel(out.data(), &input[v * frames * 2], 1 + v % 2, frames - v, 0.7f / 32768.0f, 0.3f / 32768.0f);
+			}
+			double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / passes;
+			if (k == 0)
+				reference = out;
+			bool same = out == reference;
+			ok = ok && same;
+			std::cout << "mixVoice " << variants[k].name << ": " << us << " us per 32-voice buffer" << (same ? "" : ", MISMATCH") << std::endl;
+		}
+	}
+
+	{
+		Mixer mixer(44100, 16);
+		for (unsigned short id = 0; id < SOUND_COUNT; id++)
+			mixer.upload(id, bank.clip(id));
+		MusicStream music;
+		if (music.open("pickup_sound.wav", mixer.sampleRate())) {
+			music.start();
+			mixer.music = &music;
+		}
+		WavFileOutput output("audio_bench.wav", true);
+		MixerThread thread(mixer, output, 512);
+		VoicePool voices(mixer, bank, 16);
+		if (thread.start()) {
+			// a pickup every 20 ms, a wall hit every 100, from alternating sides
+			for (int i = 0; i < 100; i++) {
+				SoundEvent event = { (unsigned short)(i % 5 == 0 ? SOUND_WALL : SOUND_PICKUP), 0.8f, glm::vec3(i % 2 ? 0.4f : -0.4f, 0.0f, 0.0f) };
+				voices.play(event);
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			}
+			thread.stop();
+			music.stop();
+			std::cout << "Mixer thread: " << thread.callbacks() << " buffers, " << thread.averageMixUs() << " us average, "
+				<< thread.maxMixUs() << " us max of " << thread.budgetUs() << " us, underruns " << thread.underruns()
+				<< "; written to audio_bench.wav" << std::endl;
+		}
+		else {
+			ok = false;
+		}
+	}
+	return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,102 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+
+// AABB (Axis-Aligned Bounding Box) structure
+struct AABB {
+	glm::vec3 min;  // Minimum corner (x, y, z)
+	glm::vec3 max;  // Maximum corner (x, y, z)
+};
+
+struct BoundingSphere {
+	glm::vec3 center;
+	float radius;
+};
+
+// box that contains nothing, ready to be grown with expand()
+inline AABB emptyAABB() {
+	return AABB{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+}
+
+inline bool isEmpty(const AABB& box) {
+	return box.min.x > box.max.x;
+}
+
+inline void expand(AABB& box, const glm::vec3& p) {
+	box.min = glm::min(box.min, p);
+	box.max = glm::max(box.max, p);
+}
+
+inline void expand(AABB& box, const AABB& other) {
+	if (isEmpty(other))
+		return;
+	box.min = glm::min(box.min, other.min);
+	box.max = glm::max(box.max, other.max);
+}
+
+// box of a local-space AABB after an affine transform (Arvo's method)
+inline AABB transformAABB(const AABB& box, const glm::mat4& m) {
+	glm::vec3 center = (box.min + box.max) * 0.5f;
+	glm::vec3 extent = (box.max - box.min) * 0.5f;
+	glm::vec3 newCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+	glm::vec3 newExtent;
+	for (int i = 0; i < 3; i++)
+		newExtent[i] = std::fabs(m[0][i]) * extent.x + std::fabs(m[1][i]) * extent.y + std::fabs(m[2][i]) * extent.z;
+	return AABB{ newCenter - newExtent, newCenter + newExtent };
+}
+
+// sphere centred on the box, with the radius reaching the farthest of the points
+inline BoundingSphere sphereAround(const AABB& box, const glm::vec3* points, unsigned int count, size_t stride) {
+	BoundingSphere sphere;
+	sphere.center = (box.min + box.max) * 0.5f;
+	float radius2 = 0.0f;
+	const char* p = (const char*)points;
+	for (unsigned int i = 0; i < count; i++, p += stride) {
+		glm::vec3 d = *(const glm::vec3*)p - sphere.center;
+		radius2 = std::fmax(radius2, glm::dot(d, d));
+	}
+	sphere.radius = std::sqrt(radius2);
+	return sphere;
+}
+
+// Times, in tick fractions, at which the interval [a0, a1] moving by v per tick
+// starts and stops overlapping the fixed [b0, b1]. Without motion they overlap
+// either always or never. The step kernels of food_kernels.h do the same math
+// lane by lane.
+const float SWEEP_NEVER = 1e30f;
+
+inline void sweepAxis(float a0, float a1, float b0, float b1, float v, float& enter, float& exit) {
+	if (v == 0.0f) {
+		bool touching = a1 >= b0 && a0 <= b1;
+		enter = touching ? -SWEEP_NEVER : SWEEP_NEVER;
+		exit = SWEEP_NEVER;
+		return;
+	}
+	float inv = 1.0f / v;
+	float t0 = (b0 - a1) * inv, t1 = (b1 - a0) * inv;
+	enter = t0 < t1 ? t0 : t1;
+	exit = t0 < t1 ? t1 : t0;
+}
+
+// Swept AABB test: first time in [0, 1] at which box a, moving by da over the
+// tick, touches box b moving by db, or a negative value when it does not happen
+// within the tick. Boxes touching at the start give 0. exitTime, when given,
+// gets the time they stop touching, at most 1.
+inline float timeOfImpact(const AABB& a, const glm::vec3& da, const AABB& b, const glm::vec3& db, float* exitTime = nullptr) {
+	glm::vec3 v = da - db;
+	float enter = 0.0f, exit = 1.0f;
+	for (int i = 0; i < 3; i++) {
+		float axisEnter, axisExit;
+		sweepAxis(a.min[i], a.max[i], b.min[i], b.max[i], v[i], axisEnter, axisExit);
+		enter = std::fmax(enter, axisEnter);
+		exit = std::fmin(exit, axisExit);
+	}
+	if (exitTime)
+		*exitTime = exit;
+	return enter <= exit ? enter : -1.0f;
+}
+#endif
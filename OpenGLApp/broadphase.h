@@ -0,0 +1,100 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include "bounds.h"
+
+#include <vector>
+
+// Two boxes whose bounds overlap; ids as given to SweepAndPrune::insert, a < b
+struct BroadphasePair {
+	unsigned int a, b;
+};
+
+// Incremental sort-and-sweep on x. Proxies stay sorted by min.x from one tick
+// to the next, and since things barely move between ticks an insertion sort
+// puts them back in order in close to linear time. The sweep then only
+// compares each box with the ones whose x interval starts inside its own, so
+// the work follows the number of real overlaps instead of n^2.
+class SweepAndPrune {
+public:
+	enum : unsigned int { NONE = 0xFFFFFFFFu };
+
+	// ids go from 0 to maxIds - 1
+	explicit SweepAndPrune(unsigned int maxIds) : slotOf(maxIds, NONE) {
+		proxies.reserve(maxIds);
+	}
+
+	void insert(unsigned int id, const AABB& box) {
+		slotOf[id] = (unsigned int)proxies.size();
+		proxies.push_back(Proxy{ box, id });
+	}
+
+	void move(unsigned int id, const AABB& box) {
+		proxies[slotOf[id]].box = box;
+	}
+
+	void remove(unsigned int id) {
+		unsigned int slot = slotOf[id];
+		proxies.erase(proxies.begin() + slot);
+		for (unsigned int i = slot; i < proxies.size(); i++)
+			slotOf[proxies[i].id] = i;
+		slotOf[id] = NONE;
+	}
+
+	bool contains(unsigned int id) const { return slotOf[id] != NONE; }
+	unsigned int size() const { return (unsigned int)proxies.size(); }
+
+	// re-sorts and fills pairs with every overlapping couple, up to maxPairs;
+	// the ones beyond are counted in droppedPairs, so a caller that reserved
+	// maxPairs never sees the vector reallocate
+	void findPairs(std::vector<BroadphasePair>& pairs, size_t maxPairs = ~(size_t)0) {
+		pairs.clear();
+		droppedPairs = 0;
+		sort();
+		for (unsigned int i = 0; i < proxies.size(); i++) {
+			const AABB& a = proxies[i].box;
+			for (unsigned int j = i + 1; j < proxies.size() && proxies[j].box.min.x <= a.max.x; j++) {
+				const AABB& b = proxies[j].box;
+				if (a.max.y >= b.min.y && a.min.y <= b.max.y && a.max.z >= b.min.z && a.min.z <= b.max.z) {
+					unsigned int idA = proxies[i].id, idB = proxies[j].id;
+					if (pairs.size() >= maxPairs) {
+						droppedPairs++;
+						continue;
+					}
+					pairs.push_back(idA < idB ? BroadphasePair{ idA, idB } : BroadphasePair{ idB, idA });
+				}
+			}
+		}
+	}
+
+	// swaps made by the last sort, a measure of how much the order changed
+	unsigned int swaps = 0;
+	// overlaps the last findPairs() found but had no room for
+	unsigned int droppedPairs = 0;
+
+private:
+	struct Proxy {
+		AABB box;
+		unsigned int id;
+	};
+	std::vector<Proxy> proxies;
+	std::vector<unsigned int> slotOf;
+
+	void sort() {
+		swaps = 0;
+		for (unsigned int i = 1; i < proxies.size(); i++) {
+			Proxy p = proxies[i];
+			unsigned int j = i;
+			for (; j > 0 && proxies[j - 1].box.min.x > p.box.min.x; j--) {
+				proxies[j] = proxies[j - 1];
+				slotOf[proxies[j].id] = j;
+				swaps++;
+			}
+			if (j != i) {
+				proxies[j] = p;
+				slotOf[p.id] = j;
+			}
+		}
+	}
+};
+#endif
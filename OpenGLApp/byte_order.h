@@ -0,0 +1,38 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <vector>
+#include <cstring>
+
+// Little endian fields for the binary files (input recordings, telemetry), so
+// they read back the same whatever the byte order of the machine. size is in
+// bytes, at most 8.
+inline void putLE(std::vector<unsigned char>& bytes, unsigned long long value, int size)
+{
+	for (int i = 0; i < size; i++)
+		bytes.push_back((unsigned char)(value >> (8 * i)));
+}
+
+inline unsigned long long getLE(const std::vector<unsigned char>& bytes, size_t at, int size)
+{
+	unsigned long long value = 0;
+	for (int i = 0; i < size; i++)
+		value |= (unsigned long long)bytes[at + i] << (8 * i);
+	return value;
+}
+
+inline void putFloatLE(std::vector<unsigned char>& bytes, float value)
+{
+	unsigned int bits;
+	std::memcpy(&bits, &value, 4);
+	putLE(bytes, bits, 4);
+}
+
+inline float getFloatLE(const std::vector<unsigned char>& bytes, size_t at)
+{
+	unsigned int bits = (unsigned int)getLE(bytes, at, 4);
+	float value;
+	std::memcpy(&value, &bits, 4);
+	return value;
+}
+#endif
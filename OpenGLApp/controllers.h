@@ -0,0 +1,61 @@
+#ifndef CONTROLLERS_H
+#define CONTROLLERS_H
+
+#include "game.h"
+
+#include <cmath>
+
+// Plate controllers for runs without a player. Each sets input.plateDirection
+// for the coming tick and nothing else.
+
+// moves the plate towards x, with a dead zone so it does not jitter around it
+inline void steerTowards(float target, float plateX, GameInput& input)
+{
+	input.plateDirection = 0;
+	if (target > plateX + 0.03f)
+		input.plateDirection = 1;
+	else if (target < plateX - 0.03f)
+		input.plateDirection = -1;
+}
+
+// sweeps the plate from side to side, whatever falls
+inline void scriptedInput(double time, float plateX, GameInput& input)
+{
+	steerTowards(0.45f * (float)std::sin(time * 1.3), plateX, input);
+}
+
+// goes for the lowest food still in play, the next one to land
+inline void chaseInput(const Game& game, GameInput& input)
+{
+	float target = game.platePosition.x;
+	float lowest = 10.0f;
+	for (unsigned int i = 0; i < game.foods.size(); i++) {
+		if (game.foods.y[i] > -1.10f && game.foods.y[i] < lowest) {
+			lowest = game.foods.y[i];
+			target = game.foods.x[i];
+		}
+	}
+	steerTowards(target, game.platePosition.x, input);
+}
+
+// like chaseInput, but skips foods the plate can no longer reach in time and
+// goes for the first one it can
+inline void plannerInput(const Game& game, GameInput& input)
+{
+	float target = game.platePosition.x;
+	float soonest = 1e9f;
+	for (unsigned int i = 0; i < game.foods.size(); i++) {
+		float y = game.foods.y[i];
+		if (y <= -1.10f)
+			continue;
+		// seconds until it reaches the plate, and seconds the plate needs to get under it
+		float arrival = (y - game.platePosition.y) / game.foodSpeed;
+		float travel = (std::fabs(game.foods.x[i] - game.platePosition.x) - 0.1f) / game.plateSpeed;
+		if (arrival >= travel && arrival < soonest) {
+			soonest = arrival;
+			target = game.foods.x[i];
+		}
+	}
+	steerTowards(target, game.platePosition.x, input);
+}
+#endif
@@ -0,0 +1,79 @@
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for many producers and one consumer (Vyukov's
+// bounded queue). Every slot carries a sequence number that says whose turn
+// it is: a producer claims a slot by advancing the tail with a CAS, writes the
+// value, then bumps the slot's sequence to hand it to the consumer. Nobody
+// ever waits on anybody: push() on a full ring fails and the event is dropped,
+// which for sound effects beats stalling the thread that posted it.
+// Capacity must be a power of two.
+template <typename T, unsigned int Capacity>
+class EventRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "EventRing capacity must be a power of two");
+
+public:
+	EventRing()
+	{
+		for (unsigned int i = 0; i < Capacity; i++)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// any thread; false when the ring is full
+	bool push(const T& value)
+	{
+		size_t position = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot& slot = slots[position & (Capacity - 1)];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+			if (difference == 0) {
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					slot.value = value;
+					slot.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else {
+				position = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// consumer thread only; false when empty
+	bool pop(T& value)
+	{
+		Slot& slot = slots[head & (Capacity - 1)];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != head + 1)
+			return false;
+		value = slot.value;
+		slot.sequence.store(head + Capacity, std::memory_order_release);
+		head++;
+		return true;
+	}
+
+	// events lost to a full ring
+	unsigned int droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	Slot slots[Capacity];
+	// producers share the tail, the consumer owns the head
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	alignas(64) size_t head = 0;
+	alignas(64) std::atomic<unsigned int> dropped{ 0 };
+};
+#endif
@@ -0,0 +1,142 @@
+#ifndef FOOD_BATCH_H
+#define FOOD_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "model.h"
+#include "gl_state.h"
+#include "frame_arena.h"
+
+#include <vector>
+
+// Layout mandated by GL for the records in GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Collects every falling food of a frame and submits them all at once.
+// All food models live in one MeshBuffer; each frame the instances are grouped
+// by type, their model matrices are streamed into an instance buffer (vertex
+// attributes 3-6, divisor 1) and one indirect command per mesh points at the
+// matching instance range through baseInstance. On GL 4.3 that is a single
+// glMultiDrawElementsIndirect; on 3.3 (no baseInstance) the instance attributes
+// are re-pointed per type and each mesh is drawn instanced, so the number of
+// calls depends on the mesh count and never on the number of foods. The
+// flattened matrices and the command list only live for the frame, in the
+// frame arena.
+class FoodBatch {
+public:
+	static const unsigned int INSTANCE_ATTRIB = 3;
+
+	// GL calls made by the last submit()
+	unsigned int drawCalls = 0;
+
+	void init(MeshBuffer& meshBuffer, const std::vector<std::vector<MeshRange> >& meshesPerType) {
+		buffer = &meshBuffer;
+		typeMeshes = meshesPerType;
+		instances.resize(typeMeshes.size());
+		useIndirect = GLAD_GL_VERSION_4_3 != 0;
+
+		glGenBuffers(1, &instanceVBO);
+		glGenBuffers(1, &indirectBuffer);
+
+		glState().bindVertexArray(buffer->VAO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		for (unsigned int i = 0; i < 4; i++) {
+			glEnableVertexAttribArray(INSTANCE_ATTRIB + i);
+			glVertexAttribDivisor(INSTANCE_ATTRIB + i, 1);
+		}
+		pointInstances(0);
+	}
+
+	void add(int type, const glm::mat4& model) {
+		instances[type].push_back(model);
+	}
+
+	void submit() {
+		drawCalls = 0;
+
+		// flatten the per-type lists and build the command list
+		size_t instanceCount = 0, commandCount = 0;
+		for (unsigned int t = 0; t < instances.size(); t++) {
+			instanceCount += instances[t].size();
+			commandCount += instances[t].empty() ? 0 : typeMeshes[t].size();
+		}
+		FrameVector<glm::mat4> staging(frameAllocator<glm::mat4>());
+		FrameVector<DrawElementsIndirectCommand> commands(frameAllocator<DrawElementsIndirectCommand>());
+		staging.reserve(instanceCount);
+		commands.reserve(commandCount);
+		for (unsigned int t = 0; t < instances.size(); t++) {
+			if (instances[t].empty())
+				continue;
+			GLuint baseInstance = (GLuint)staging.size();
+			staging.insert(staging.end(), instances[t].begin(), instances[t].end());
+			for (unsigned int m = 0; m < typeMeshes[t].size(); m++) {
+				const MeshRange& r = typeMeshes[t][m];
+				DrawElementsIndirectCommand cmd = { r.indexCount, (GLuint)instances[t].size(), r.firstIndex, r.baseVertex, baseInstance };
+				commands.push_back(cmd);
+			}
+			instances[t].clear();
+		}
+		if (commands.empty())
+			return;
+
+		glState().bindVertexArray(buffer->VAO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		// orphan and refill so we never wait on last frame's draws
+		glBufferData(GL_ARRAY_BUFFER, staging.size() * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, staging.size() * sizeof(glm::mat4), staging.data());
+
+		if (useIndirect) {
+			glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)commands.size(), 0);
+			drawCalls = 1;
+			unsigned long long triangles = 0;
+			for (unsigned int i = 0; i < commands.size(); i++)
+				triangles += (unsigned long long)commands[i].count / 3 * commands[i].instanceCount;
+			countDraw(triangles);
+			return;
+		}
+
+		GLuint pointedAt = 0;
+		for (unsigned int i = 0; i < commands.size(); i++) {
+			const DrawElementsIndirectCommand& cmd = commands[i];
+			if (cmd.baseInstance != pointedAt) {
+				pointInstances(cmd.baseInstance);
+				pointedAt = cmd.baseInstance;
+			}
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT,
+				(void*)(cmd.firstIndex * sizeof(unsigned int)), cmd.instanceCount, cmd.baseVertex);
+			drawCalls++;
+			countDraw((unsigned long long)cmd.count / 3 * cmd.instanceCount);
+		}
+		if (pointedAt != 0)
+			pointInstances(0);
+	}
+
+	void destroy() {
+		glDeleteBuffers(1, &instanceVBO);
+		glDeleteBuffers(1, &indirectBuffer);
+	}
+
+private:
+	MeshBuffer* buffer = nullptr;
+	std::vector<std::vector<MeshRange> > typeMeshes;
+	std::vector<std::vector<glm::mat4> > instances;
+	unsigned int instanceVBO = 0, indirectBuffer = 0;
+	bool useIndirect = false;
+
+	// the mat4 takes four vec4 attribute slots; expects the instance VBO to be bound
+	void pointInstances(GLuint firstInstance) {
+		size_t base = firstInstance * sizeof(glm::mat4);
+		for (unsigned int i = 0; i < 4; i++)
+			glVertexAttribPointer(INSTANCE_ATTRIB + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(base + i * sizeof(glm::vec4)));
+	}
+};
+#endif
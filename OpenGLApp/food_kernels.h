@@ -0,0 +1,151 @@
+#ifndef FOOD_KERNELS_H
+#define FOOD_KERNELS_H
+
+#include "bounds.h"
+#include "simd.h"
+
+#include <cmath>
+
+// Positions and collision boxes of foods stored as separate arrays. A food's
+// box spans x +- halfX, y + lowY .. y + highY and z +- halfZ.
+struct FoodArrays {
+	const float* x;
+	float* y;
+	const float* z;
+	float* prevY;
+	const float* halfX;
+	const float* lowY;
+	const float* highY;
+	const float* halfZ;
+};
+
+// One simulation step: each food falls by dy (the old y goes to prevY) while
+// the plate, given by its box at the start of the tick, slides by plateDx. The
+// food box is swept against the plate box over the tick as timeOfImpact does,
+// so a fast food cannot fall through the thin plate between two ticks. hits[i]
+// gets 1 for every food touching the plate at some point of the tick, 0
+// otherwise; returns the number of hits.
+inline unsigned int stepFoodsScalar(const FoodArrays& f, unsigned int begin, unsigned int count, float dy, const AABB& plate, float plateDx, unsigned char* hits)
+{
+	unsigned int n = 0;
+	for (unsigned int i = begin; i < count; i++) {
+		float y = f.y[i];
+		f.prevY[i] = y;
+		f.y[i] = y - dy;
+		float enterX, exitX, enterY, exitY;
+		sweepAxis(f.x[i] - f.halfX[i], f.x[i] + f.halfX[i], plate.min.x, plate.max.x, -plateDx, enterX, exitX);
+		sweepAxis(y + f.lowY[i], y + f.highY[i], plate.min.y, plate.max.y, -dy, enterY, exitY);
+		bool hit = std::fmax(std::fmax(enterX, enterY), 0.0f) <= std::fmin(std::fmin(exitX, exitY), 1.0f) &&
+			(f.z[i] + f.halfZ[i] >= plate.min.z && f.z[i] - f.halfZ[i] <= plate.max.z);
+		hits[i] = hit ? 1 : 0;
+		n += hits[i];
+	}
+	return n;
+}
+
+#ifdef SIMD_SSE2
+// sweepAxis for four intervals moving at the same speed
+inline void sweepAxisSSE(__m128 a0, __m128 a1, float b0, float b1, float v, __m128& enter, __m128& exit)
+{
+	if (v == 0.0f) {
+		__m128 touching = _mm_and_ps(_mm_cmpge_ps(a1, _mm_set1_ps(b0)), _mm_cmple_ps(a0, _mm_set1_ps(b1)));
+		enter = _mm_or_ps(_mm_and_ps(touching, _mm_set1_ps(-SWEEP_NEVER)), _mm_andnot_ps(touching, _mm_set1_ps(SWEEP_NEVER)));
+		exit = _mm_set1_ps(SWEEP_NEVER);
+		return;
+	}
+	__m128 inv = _mm_set1_ps(1.0f / v);
+	__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(b0), a1), inv);
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(b1), a0), inv);
+	enter = _mm_min_ps(t0, t1);
+	exit = _mm_max_ps(t0, t1);
+}
+
+inline unsigned int stepFoodsSSE(const FoodArrays& f, unsigned int begin, unsigned int count, float dy, const AABB& plate, float plateDx, unsigned char* hits)
+{
+	const __m128 vdy = _mm_set1_ps(dy);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	const __m128 minZ = _mm_set1_ps(plate.min.z), maxZ = _mm_set1_ps(plate.max.z);
+	unsigned int n = 0;
+	unsigned int i = begin;
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(f.x + i);
+		__m128 vy = _mm_loadu_ps(f.y + i);
+		__m128 vz = _mm_loadu_ps(f.z + i);
+		__m128 hw = _mm_loadu_ps(f.halfX + i);
+		__m128 hd = _mm_loadu_ps(f.halfZ + i);
+		_mm_storeu_ps(f.prevY + i, vy);
+		_mm_storeu_ps(f.y + i, _mm_sub_ps(vy, vdy));
+		__m128 enterX, exitX, enterY, exitY;
+		sweepAxisSSE(_mm_sub_ps(vx, hw), _mm_add_ps(vx, hw), plate.min.x, plate.max.x, -plateDx, enterX, exitX);
+		sweepAxisSSE(_mm_add_ps(vy, _mm_loadu_ps(f.lowY + i)), _mm_add_ps(vy, _mm_loadu_ps(f.highY + i)), plate.min.y, plate.max.y, -dy, enterY, exitY);
+		__m128 in = _mm_cmple_ps(_mm_max_ps(_mm_max_ps(enterX, enterY), zero), _mm_min_ps(_mm_min_ps(exitX, exitY), one));
+		in = _mm_and_ps(in, _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(vz, hd), minZ), _mm_cmple_ps(_mm_sub_ps(vz, hd), maxZ)));
+		int mask = _mm_movemask_ps(in);
+		for (int k = 0; k < 4; k++) {
+			hits[i + k] = (mask >> k) & 1;
+			n += hits[i + k];
+		}
+	}
+	return n + stepFoodsScalar(f, i, count, dy, plate, plateDx, hits);
+}
+#endif
+
+#ifdef SIMD_AVX2
+// sweepAxis for eight intervals moving at the same speed
+inline void sweepAxisAVX2(__m256 a0, __m256 a1, float b0, float b1, float v, __m256& enter, __m256& exit)
+{
+	if (v == 0.0f) {
+		__m256 touching = _mm256_and_ps(_mm256_cmp_ps(a1, _mm256_set1_ps(b0), _CMP_GE_OQ), _mm256_cmp_ps(a0, _mm256_set1_ps(b1), _CMP_LE_OQ));
+		enter = _mm256_blendv_ps(_mm256_set1_ps(SWEEP_NEVER), _mm256_set1_ps(-SWEEP_NEVER), touching);
+		exit = _mm256_set1_ps(SWEEP_NEVER);
+		return;
+	}
+	__m256 inv = _mm256_set1_ps(1.0f / v);
+	__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(b0), a1), inv);
+	__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(b1), a0), inv);
+	enter = _mm256_min_ps(t0, t1);
+	exit = _mm256_max_ps(t0, t1);
+}
+
+inline unsigned int stepFoodsAVX2(const FoodArrays& f, unsigned int begin, unsigned int count, float dy, const AABB& plate, float plateDx, unsigned char* hits)
+{
+	const __m256 vdy = _mm256_set1_ps(dy);
+	const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+	const __m256 minZ = _mm256_set1_ps(plate.min.z), maxZ = _mm256_set1_ps(plate.max.z);
+	unsigned int n = 0;
+	unsigned int i = begin;
+	for (; i + 8 <= count; i += 8) {
+		__m256 vx = _mm256_loadu_ps(f.x + i);
+		__m256 vy = _mm256_loadu_ps(f.y + i);
+		__m256 vz = _mm256_loadu_ps(f.z + i);
+		__m256 hw = _mm256_loadu_ps(f.halfX + i);
+		__m256 hd = _mm256_loadu_ps(f.halfZ + i);
+		_mm256_storeu_ps(f.prevY + i, vy);
+		_mm256_storeu_ps(f.y + i, _mm256_sub_ps(vy, vdy));
+		__m256 enterX, exitX, enterY, exitY;
+		sweepAxisAVX2(_mm256_sub_ps(vx, hw), _mm256_add_ps(vx, hw), plate.min.x, plate.max.x, -plateDx, enterX, exitX);
+		sweepAxisAVX2(_mm256_add_ps(vy, _mm256_loadu_ps(f.lowY + i)), _mm256_add_ps(vy, _mm256_loadu_ps(f.highY + i)), plate.min.y, plate.max.y, -dy, enterY, exitY);
+		__m256 in = _mm256_cmp_ps(_mm256_max_ps(_mm256_max_ps(enterX, enterY), zero), _mm256_min_ps(_mm256_min_ps(exitX, exitY), one), _CMP_LE_OQ);
+		in = _mm256_and_ps(in, _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(vz, hd), minZ, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_sub_ps(vz, hd), maxZ, _CMP_LE_OQ)));
+		int mask = _mm256_movemask_ps(in);
+		for (int k = 0; k < 8; k++) {
+			hits[i + k] = (mask >> k) & 1;
+			n += hits[i + k];
+		}
+	}
+	return n + stepFoodsSSE(f, i, count, dy, plate, plateDx, hits);
+}
+#endif
+
+// the widest kernel this build was compiled for
+inline unsigned int stepFoods(const FoodArrays& f, unsigned int count, float dy, const AABB& plate, float plateDx, unsigned char* hits)
+{
+#if defined(SIMD_AVX2)
+	return stepFoodsAVX2(f, 0, count, dy, plate, plateDx, hits);
+#elif defined(SIMD_SSE2)
+	return stepFoodsSSE(f, 0, count, dy, plate, plateDx, hits);
+#else
+	return stepFoodsScalar(f, 0, count, dy, plate, plateDx, hits);
+#endif
+}
+#endif
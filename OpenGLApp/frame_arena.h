@@ -0,0 +1,243 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+// Scratch memory for one frame. Allocating bumps an offset and nothing is
+// freed on its own: the whole arena is reset once the frame has been handed
+// to glfwSwapBuffers. Nothing taken from it may be kept past that. Render
+// thread only.
+//
+//   glm::mat4* matrices = frameArena().allocArray<glm::mat4>(count);
+//   FrameVector<DrawElementsIndirectCommand> commands(frameAllocator<DrawElementsIndirectCommand>());
+//   renderText(shader, frameArena().format("FPS %.1f", fps), ...);
+//
+// A frame that needs more than the arena holds takes the rest from the heap,
+// and the arena grows to fit at the next reset, so only the first such frames
+// allocate. With FRAME_ARENA_DEBUG (the default without NDEBUG) new memory is
+// filled with 0xCD and reset memory with 0xDD, and every allocation is
+// followed by a guard that reset() checks. Writes past an allocation and
+// reads of last frame's data then show up.
+#ifndef FRAME_ARENA_DEBUG
+#ifdef NDEBUG
+#define FRAME_ARENA_DEBUG 0
+#else
+#define FRAME_ARENA_DEBUG 1
+#endif
+#endif
+
+#include "logging.h"
+
+#include <vector>
+#include <string>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+
+class FrameArena {
+public:
+	explicit FrameArena(size_t capacity = 256 * 1024)
+	{
+		spills.reserve(16);
+		grow(capacity);
+	}
+	~FrameArena()
+	{
+		releaseSpills();
+		::operator delete(base);
+	}
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// uninitialized bytes (0xCD in debug), valid until the next reset()
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+	{
+#if FRAME_ARENA_DEBUG
+		// [header][bytes][guard]; the headers chain back so reset() can find every guard
+		size_t start = alignUp(top + sizeof(Header), alignment);
+		if (start + bytes + GUARD > capacity)
+			return spill(bytes, alignment);
+		Header header = { (unsigned int)bytes, lastHeader };
+		std::memcpy(base + start - sizeof(Header), &header, sizeof(Header));
+		lastHeader = (unsigned int)(start - sizeof(Header)) + 1;
+		std::memset(base + start, 0xCD, bytes);
+		std::memset(base + start + bytes, GUARD_BYTE, GUARD);
+		top = start + bytes + GUARD;
+#else
+		size_t start = alignUp(top, alignment);
+		if (start + bytes > capacity)
+			return spill(bytes, alignment);
+		top = start + bytes;
+#endif
+		return base + start;
+	}
+
+	// count default-constructed Ts; the arena never runs destructors
+	template <typename T>
+	T* allocArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "the frame arena never runs destructors");
+		T* items = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+		for (size_t i = 0; i < count; i++)
+			new (items + i) T();
+		return items;
+	}
+
+	// printf into the arena, for the strings a frame draws and forgets
+	const char* format(const char* fmt, ...)
+	{
+		va_list args;
+		va_start(args, fmt);
+		int length = std::vsnprintf(nullptr, 0, fmt, args);
+		va_end(args);
+		if (length < 0)
+			return "";
+		char* text = static_cast<char*>(allocate(length + 1, 1));
+		va_start(args, fmt);
+		std::vsnprintf(text, length + 1, fmt, args);
+		va_end(args);
+		return text;
+	}
+
+	// end of frame: checks the guards, frees the spills and grows to fit what the frame wanted
+	void reset()
+	{
+#if FRAME_ARENA_DEBUG
+		checkGuards();
+		std::memset(base, 0xDD, top);
+		lastHeader = 0;
+#endif
+		size_t demand = top + spilled;
+		peakBytes = std::max(peakBytes, demand);
+		if (spilled) {
+			// room for the whole frame and then some, so a slowly growing scene does not spill every frame
+			size_t grown = capacity;
+			while (grown < demand + demand / 4)
+				grown *= 2;
+			LOG_WARN(MEMORY, "frame arena: %zu bytes spilled to the heap, growing from %zu to %zu bytes", spilled, capacity, grown);
+			releaseSpills();
+			::operator delete(base);
+			grow(grown);
+		}
+		lastBytes = demand;
+		top = 0;
+		spilled = 0;
+	}
+
+	size_t used() const { return top + spilled; }       // so far this frame
+	size_t usedLastFrame() const { return lastBytes; }  // at the last reset
+	size_t peak() const { return peakBytes; }
+	size_t size() const { return capacity; }
+	unsigned int overruns() const { return overrunCount; } // guards found broken, debug only
+
+private:
+	enum : unsigned int {
+		GUARD = 8,
+		GUARD_BYTE = 0xFD,
+	};
+
+	struct Header {
+		unsigned int bytes;
+		unsigned int previous; // offset of the previous header + 1, 0 for none
+	};
+
+	char* base = nullptr;
+	size_t capacity = 0;
+	size_t top = 0;
+	size_t spilled = 0;
+	size_t lastBytes = 0;
+	size_t peakBytes = 0;
+	unsigned int lastHeader = 0;
+	unsigned int overrunCount = 0;
+	std::vector<void*> spills; // heap blocks of this frame, freed at reset()
+
+	static size_t alignUp(size_t offset, size_t alignment) { return (offset + alignment - 1) & ~(alignment - 1); }
+
+	void grow(size_t bytes)
+	{
+		base = static_cast<char*>(::operator new(bytes));
+		capacity = bytes;
+#if FRAME_ARENA_DEBUG
+		std::memset(base, 0xDD, capacity);
+#endif
+	}
+
+	void* spill(size_t bytes, size_t alignment)
+	{
+		void* block = ::operator new(bytes + alignment);
+		spills.push_back(block);
+		spilled += bytes + alignment;
+		char* aligned = static_cast<char*>(block) + (alignment - (std::uintptr_t)block % alignment) % alignment;
+#if FRAME_ARENA_DEBUG
+		std::memset(aligned, 0xCD, bytes);
+#endif
+		return aligned;
+	}
+
+	void releaseSpills()
+	{
+		for (size_t i = 0; i < spills.size(); i++)
+			::operator delete(spills[i]);
+		spills.clear();
+	}
+
+	void checkGuards()
+	{
+		for (unsigned int at = lastHeader; at; ) {
+			Header header;
+			std::memcpy(&header, base + at - 1, sizeof(Header));
+			const unsigned char* guard = reinterpret_cast<const unsigned char*>(base + at - 1 + sizeof(Header) + header.bytes);
+			for (unsigned int i = 0; i < GUARD; i++) {
+				if (guard[i] != GUARD_BYTE) {
+					LOG_ERROR(MEMORY, "frame arena: written past the end of a %u byte allocation", header.bytes);
+					overrunCount++;
+					break;
+				}
+			}
+			at = header.previous;
+		}
+	}
+};
+
+inline FrameArena& frameArena()
+{
+	static FrameArena instance;
+	return instance;
+}
+
+// Lets standard containers live in the arena for a frame. deallocate() does
+// nothing, so a container that grows leaves its old storage behind until the
+// reset: reserve() what is known up front.
+template <typename T>
+class FrameAllocator {
+public:
+	typedef T value_type;
+
+	explicit FrameAllocator(FrameArena& arena) : arena(&arena) {}
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U>
+	bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+	template <typename U>
+	friend class FrameAllocator;
+	FrameArena* arena;
+};
+
+template <typename T>
+inline FrameAllocator<T> frameAllocator() { return FrameAllocator<T>(frameArena()); }
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T> >;
+typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char> > FrameString;
+#endif
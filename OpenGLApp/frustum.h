@@ -0,0 +1,107 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "simd.h"
+
+#include <vector>
+#include <cmath>
+
+// The six planes of a view frustum, normals pointing inwards (ax + by + cz + d >= 0 is inside)
+class Frustum {
+public:
+	glm::vec4 planes[6];
+
+	// Gribb/Hartmann extraction from a projection * view matrix
+	void extract(const glm::mat4& m) {
+		for (int i = 0; i < 3; i++) {
+			glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+			glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+			planes[i * 2] = row3 + row;
+			planes[i * 2 + 1] = row3 - row;
+		}
+		for (int i = 0; i < 6; i++) {
+			float len = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+			planes[i] = planes[i] * (1.0f / len);
+		}
+	}
+
+	// "positive vertex" test: false only when the box is completely behind one plane
+	bool intersects(const AABB& box) const {
+		for (int i = 0; i < 6; i++) {
+			const glm::vec4& p = planes[i];
+			glm::vec3 v(p.x >= 0.0f ? box.max.x : box.min.x,
+				p.y >= 0.0f ? box.max.y : box.min.y,
+				p.z >= 0.0f ? box.max.z : box.min.z);
+			if (p.x * v.x + p.y * v.y + p.z * v.z + p.w < 0.0f)
+				return false;
+		}
+		return true;
+	}
+};
+
+// Spheres waiting to be tested against a frustum, stored as structure of arrays
+// so four of them go through each plane at once
+class SphereBatch {
+public:
+	std::vector<unsigned int> ids; // caller's index for every sphere
+	std::vector<float> x, y, z, r;
+	std::vector<unsigned char> visible;
+
+	void clear() {
+		ids.clear();
+		x.clear();
+		y.clear();
+		z.clear();
+		r.clear();
+	}
+
+	void add(unsigned int id, const glm::vec3& center, float radius) {
+		ids.push_back(id);
+		x.push_back(center.x);
+		y.push_back(center.y);
+		z.push_back(center.z);
+		r.push_back(radius);
+	}
+
+	unsigned int size() const { return (unsigned int)ids.size(); }
+
+	// fills visible[i] with 1 when sphere i is at least partly inside the frustum
+	void cull(const Frustum& frustum) {
+		unsigned int n = size();
+		visible.resize(n);
+		unsigned int i = 0;
+#ifdef SIMD_SSE2
+		for (; i + 4 <= n; i += 4) {
+			__m128 cx = _mm_loadu_ps(&x[i]);
+			__m128 cy = _mm_loadu_ps(&y[i]);
+			__m128 cz = _mm_loadu_ps(&z[i]);
+			__m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&r[i]));
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < 6; p++) {
+				const glm::vec4& pl = frustum.planes[p];
+				__m128 d = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(pl.x)), _mm_mul_ps(cy, _mm_set1_ps(pl.y)));
+				d = _mm_add_ps(d, _mm_mul_ps(cz, _mm_set1_ps(pl.z)));
+				d = _mm_add_ps(d, _mm_set1_ps(pl.w));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negR));
+			}
+			int mask = _mm_movemask_ps(outside);
+			for (int k = 0; k < 4; k++)
+				visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+		}
+#endif
+		for (; i < n; i++) {
+			visible[i] = 1;
+			for (int p = 0; p < 6; p++) {
+				const glm::vec4& pl = frustum.planes[p];
+				if (pl.x * x[i] + pl.y * y[i] + pl.z * z[i] + pl.w < -r[i]) {
+					visible[i] = 0;
+					break;
+				}
+			}
+		}
+	}
+};
+#endif
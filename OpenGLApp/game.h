@@ -0,0 +1,527 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "pool.h"
+#include "food_kernels.h"
+#include "broadphase.h"
+#include "hull.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+struct Food {
+	glm::vec3 position;
+	glm::vec3 previous; // position at the previous tick, for interpolation
+	int type;
+};
+
+// 0..n-1, uniformly, straight from the generator's output. mt19937 yields
+// the same numbers everywhere, but std::uniform_int_distribution maps them in
+// an implementation-defined way (MSVC and libstdc++ differ), so rejecting the
+// top partial range by hand is what keeps a seed's spawns the same on every
+// build.
+inline int randomIndex(std::mt19937& gen, unsigned int n) {
+	const unsigned long long range = 0x100000000ULL; // mt19937 gives 32 bits
+	const unsigned long long limit = range - range % n;
+	unsigned long long value;
+	do
+		value = gen();
+	while (value >= limit);
+	return (int)(value % n);
+}
+
+// Spawn randomness comes from the caller's generator, so a game seeded the
+// same way spawns the same foods, whatever the compiler
+inline glm::vec3 generateRandomPosition(std::mt19937& gen) {
+	// Fixed x positions
+	float xPositions[3] = { -0.50f, 0.0f, 0.50f };
+
+	float randomX = xPositions[randomIndex(gen, 3)]; // Pick a random lane
+
+	return glm::vec3(randomX, 1.20f, 0.0f); // Fixed y and z
+}
+
+inline int generateRandomObject(std::mt19937& gen) {
+	return randomIndex(gen, 3);
+}
+
+// unseeded variants, different every run
+inline std::mt19937& randomGenerator() {
+	static std::random_device rd; // Seed
+	static std::mt19937 gen(rd()); // Random number generator
+	return gen;
+}
+
+inline glm::vec3 generateRandomPosition() {
+	return generateRandomPosition(randomGenerator());
+}
+
+inline int generateRandomObject() {
+	return generateRandomObject(randomGenerator());
+}
+
+// Function to create an AABB from position
+inline AABB createAABB(const glm::vec3& position) {
+	// Assuming the object has a fixed size of 0.2f x 0.2f
+	float halfWidth = 0.1f;  // Half of the object's width
+	float halfHeight = 0.1f; // Half of the object's height
+
+	return AABB{
+		glm::vec3(position.x - halfWidth, position.y - halfHeight, position.z - 0.01f),  // min
+		glm::vec3(position.x + halfWidth, position.y + halfHeight, position.z + 0.01f)   // max
+	};
+}
+
+// Function to check for collision between two AABBs
+inline bool checkCollision(const AABB& a, const AABB& b) {
+	return (a.max.x >= b.min.x && a.min.x <= b.max.x) &&
+		(a.max.y >= b.min.y && a.min.y <= b.max.y) &&
+		(a.max.z >= b.min.z && a.min.z <= b.max.z);
+}
+
+// What a food type or the plate collides as: the local bounds and convex hull
+// of its model, and the scale it is drawn at. The default is the fixed
+// 0.2 x 0.2 x 0.02 box createAABB has always used, for models that did not load.
+struct CollisionShape {
+	AABB bounds;
+	std::vector<glm::vec3> hull;
+	glm::vec3 scale;
+
+	CollisionShape() : bounds(createAABB(glm::vec3(0.0f))), scale(1.0f) {
+		for (int i = 0; i < 8; i++)
+			hull.push_back(glm::vec3(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z));
+	}
+	CollisionShape(const AABB& bounds, const std::vector<glm::vec3>& hull, const glm::vec3& scale)
+		: bounds(bounds), hull(hull), scale(scale) {}
+
+	// world box of an instance that is not rotated
+	AABB at(const glm::vec3& position) const {
+		return AABB{ position + bounds.min * scale, position + bounds.max * scale };
+	}
+};
+
+// Box offsets of a food around its position. Foods spin about y, so x and z
+// take the hull's largest distance from that axis, which holds at any angle.
+struct FoodExtents {
+	float halfX, lowY, highY, halfZ;
+};
+
+inline FoodExtents spinningExtents(const CollisionShape& shape) {
+	float radius = 0.0f;
+	for (unsigned int i = 0; i < shape.hull.size(); i++)
+		radius = std::fmax(radius, std::sqrt(shape.hull[i].x * shape.hull[i].x + shape.hull[i].z * shape.hull[i].z));
+	radius *= std::fmax(shape.scale.x, shape.scale.z);
+	return FoodExtents{ radius, shape.bounds.min.y * shape.scale.y, shape.bounds.max.y * shape.scale.y, radius };
+}
+
+// Live foods as one array per field, packed by a HandleTable, so a tick can run
+// the step kernels of food_kernels.h over them. Foods only ever fall, so x and z
+// need no previous value.
+class FoodStore {
+public:
+	std::vector<float> x, y, z;
+	std::vector<float> prevY;
+	std::vector<float> halfX, lowY, highY, halfZ; // collision box, see FoodExtents
+	std::vector<int> type;
+	std::vector<unsigned char> hits; // written by the last step
+
+	explicit FoodStore(unsigned int capacity) : handles(capacity) {
+		x.reserve(capacity);
+		y.reserve(capacity);
+		z.reserve(capacity);
+		prevY.reserve(capacity);
+		halfX.reserve(capacity);
+		lowY.reserve(capacity);
+		highY.reserve(capacity);
+		halfZ.reserve(capacity);
+		type.reserve(capacity);
+		hits.reserve(capacity);
+	}
+
+	unsigned int size() const { return handles.size(); }
+	unsigned int capacity() const { return handles.capacity(); }
+	bool full() const { return handles.full(); }
+
+	// returns the new food's handle, or HandleTable::INVALID when full
+	unsigned int add(const Food& food, const FoodExtents& extents) {
+		unsigned int handle = handles.add();
+		if (handle == HandleTable::INVALID)
+			return handle;
+		x.push_back(food.position.x);
+		y.push_back(food.position.y);
+		z.push_back(food.position.z);
+		prevY.push_back(food.previous.y);
+		halfX.push_back(extents.halfX);
+		lowY.push_back(extents.lowY);
+		highY.push_back(extents.highY);
+		halfZ.push_back(extents.halfZ);
+		type.push_back(food.type);
+		hits.push_back(0);
+		return handle;
+	}
+
+	// removes the food at dense index i; the last one moves into its place
+	void remove(unsigned int i) {
+		handles.remove(i);
+		removeAt(x, i);
+		removeAt(y, i);
+		removeAt(z, i);
+		removeAt(prevY, i);
+		removeAt(halfX, i);
+		removeAt(lowY, i);
+		removeAt(highY, i);
+		removeAt(halfZ, i);
+		removeAt(type, i);
+		removeAt(hits, i);
+	}
+
+	Food get(unsigned int i) const {
+		Food food;
+		food.position = glm::vec3(x[i], y[i], z[i]);
+		food.previous = glm::vec3(x[i], prevY[i], z[i]);
+		food.type = type[i];
+		return food;
+	}
+
+	void setExtents(unsigned int i, const FoodExtents& extents) {
+		halfX[i] = extents.halfX;
+		lowY[i] = extents.lowY;
+		highY[i] = extents.highY;
+		halfZ[i] = extents.halfZ;
+	}
+
+	// world box of the food at dense index i
+	AABB box(unsigned int i) const {
+		return AABB{ glm::vec3(x[i] - halfX[i], y[i] + lowY[i], z[i] - halfZ[i]), glm::vec3(x[i] + halfX[i], y[i] + highY[i], z[i] + halfZ[i]) };
+	}
+
+	FoodArrays arrays() {
+		return FoodArrays{ x.data(), y.data(), z.data(), prevY.data(), halfX.data(), lowY.data(), highY.data(), halfZ.data() };
+	}
+
+	unsigned int handle(unsigned int i) const { return handles.handle(i); }
+	unsigned int index(unsigned int handle) const { return handles.index(handle); }
+
+private:
+	HandleTable handles;
+
+	template <typename T>
+	static void removeAt(std::vector<T>& v, unsigned int i) {
+		v[i] = v.back();
+		v.pop_back();
+	}
+};
+
+// Something that happened during a tick, for whoever presents the game (sound, effects)
+struct GameEvent {
+	enum Type { COLLECTED, MISSED, WALL_HIT } type;
+	glm::vec3 position;
+};
+
+// Player input, sampled once per rendered frame and applied to every tick run in it
+struct GameInput {
+	int plateDirection = 0; // -1 left, 1 right, 0 still
+};
+
+// shortest time between spawns; the level curve stops shrinking the delay here
+const float MIN_SPAWN_DELAY = 0.1f;
+
+// The level curve and the spawn timer, for Game::tick and BatchSim alike.
+// Both timers advance by whole intervals instead of jumping to time, and a
+// tick that spans several spawn intervals spawns once for each, so levels and
+// spawns fall at the same simulated times at any tick rate. Returns how many
+// foods to spawn this tick.
+inline int advanceLevel(double time, float increaseDifficulty, float speedStep, float delayStep,
+	int& level, double& pastDifficulty, float& foodSpeed, float& delay, double& pastTime)
+{
+	while (time >= pastDifficulty + increaseDifficulty) {
+		if (level > 1) foodSpeed += speedStep / level;
+		delay = std::max(delay - delayStep / level, MIN_SPAWN_DELAY);
+		pastDifficulty += increaseDifficulty;
+		level++;
+	}
+	int spawns = 0;
+	for (float interval = std::max(delay, MIN_SPAWN_DELAY); time >= pastTime + interval; pastTime += interval)
+		spawns++;
+	return spawns;
+}
+
+// The game rules, free of GL and GLFW. The game only ever advances by whole
+// fixed ticks; all speeds are per simulated second, so gameplay is the same at
+// any tick rate and any frame rate. Positions of the tick before are kept so
+// the renderer can interpolate between the last two states.
+class Game {
+public:
+	// live foods at most; a spawn that finds the pool full is skipped
+	static const unsigned int MAX_FOODS = 1024;
+
+	// the old per-frame steps, times the 60 Hz they were tuned at
+	float plateSpeed = 1.8f;   // 0.03 per frame
+	float beltSpeed = 0.12f;   // 0.002 per frame
+	float foodSpeed = 0.42f;   // 0.007 per frame, grows with the level
+	float delay = 2.0f;        // seconds between spawns, shrinks with the level down to MIN_SPAWN_DELAY
+	float increaseDifficulty = 6.0f; // seconds per level
+	// level curve: finishing level n takes delayStep / n off the delay and,
+	// from level 2 on, adds speedStep / n to the food speed
+	float speedStep = 0.18f;
+	float delayStep = 0.5f;
+
+	FoodStore foods;
+	glm::vec3 platePosition = glm::vec3(0.0f, -1.10f, 0.0f);
+	glm::vec3 previousPlatePosition = glm::vec3(0.0f, -1.10f, 0.0f);
+	glm::vec3 beltPositions[2] = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 2.4f, 0.0f) };
+	glm::vec3 previousBeltPositions[2] = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 2.4f, 0.0f) };
+
+	double time = 0.0;          // simulated seconds
+	unsigned long long ticks = 0;
+	int level = 1;
+	int numberOfCollisions = 0;
+	int numberOfObject = 0;
+	int numberMissed = 0;       // foods that reached the bottom without being collected
+	std::vector<GameEvent> events; // of the last tick only
+
+	// broadphase over foods (ids are their handles), the plate and the two belt halves;
+	// the candidate pairs of the last tick, for a narrowphase to resolve
+	SweepAndPrune broadphase;
+	std::vector<BroadphasePair> pairs;
+	unsigned int foodFoodPairs = 0;
+	unsigned int droppedPairs = 0; // beyond MAX_PAIRS, not in pairs
+	float broadphaseMicros = 0.0f;
+	bool trackPairs = true;     // off for runs that only want the rules, like --balance
+	static const unsigned int PLATE_ID = MAX_FOODS;
+	static const unsigned int BELT_ID = MAX_FOODS + 1;
+	// every food against a belt half, the plate and a few neighbours leaves
+	// plenty of room; a pile that overlaps more than this drops the rest
+	// instead of growing the vector mid-tick
+	static const unsigned int MAX_PAIRS = MAX_FOODS * 8;
+
+	// collision shapes per food type and of the plate, see setShapes; with
+	// narrowphase on, a box hit only counts when the convex hulls touch too
+	CollisionShape foodShapes[3];
+	CollisionShape plateShape;
+	FoodExtents foodExtents[3];
+	bool narrowphase = false;
+	int narrowphaseRejects = 0;
+
+	// spawn randomness; seed it for a repeatable game
+	std::mt19937 rng;
+
+	explicit Game(unsigned int seed = std::random_device()()) : foods(MAX_FOODS), broadphase(MAX_FOODS + 3), rng(seed) {
+		for (int t = 0; t < 3; t++)
+			foodExtents[t] = spinningExtents(foodShapes[t]);
+		broadphase.insert(PLATE_ID, plateShape.at(platePosition));
+		for (int i = 0; i < 2; i++)
+			broadphase.insert(BELT_ID + i, beltAABB(beltPositions[i]));
+		pairs.reserve(MAX_PAIRS);
+		events.reserve(MAX_FOODS);
+		spawn();
+	}
+
+	// shapes taken from the loaded models; call before the first tick
+	void setShapes(const CollisionShape food[3], const CollisionShape& plate) {
+		for (int t = 0; t < 3; t++) {
+			foodShapes[t] = food[t];
+			foodExtents[t] = spinningExtents(food[t]);
+		}
+		plateShape = plate;
+		for (unsigned int i = 0; i < foods.size(); i++)
+			foods.setExtents(i, foodExtents[foods.type[i]]);
+	}
+
+	// adds a food at position unless the pool is full; returns its handle or HandleTable::INVALID
+	unsigned int drop(const glm::vec3& position, int type) {
+		if (foods.full())
+			return HandleTable::INVALID;
+		Food food;
+		food.position = position;
+		food.previous = position;
+		food.type = type;
+		unsigned int handle = foods.add(food, foodExtents[type]);
+		broadphase.insert(handle, foods.box(foods.index(handle)));
+		numberOfObject++;
+		return handle;
+	}
+
+	void tick(float dt, const GameInput& input) {
+		// foods that landed or were collected last tick have been drawn there once; retire them
+		events.clear();
+		for (unsigned int i = foods.size(); i > 0; i--) {
+			if (foods.y[i - 1] <= -1.10f) {
+				if (!foods.hits[i - 1]) {
+					numberMissed++;
+					events.push_back(GameEvent{ GameEvent::MISSED, glm::vec3(foods.x[i - 1], foods.y[i - 1], foods.z[i - 1]) });
+				}
+				broadphase.remove(foods.handle(i - 1));
+				foods.remove(i - 1);
+			}
+		}
+
+		previousPlatePosition = platePosition;
+		for (int i = 0; i < 2; i++)
+			previousBeltPositions[i] = beltPositions[i];
+
+		time += dt;
+		ticks++;
+
+		// keep adding foods
+		for (int n = advanceLevel(time, increaseDifficulty, speedStep, delayStep, level, pastDifficulty, foodSpeed, delay, pastTime); n > 0; n--)
+			spawn();
+
+		// plate, stopping at the belt border
+		platePosition.x += input.plateDirection * plateSpeed * dt;
+		platePosition.x = glm::clamp(platePosition.x, -0.45f, 0.45f);
+		if (std::fabs(platePosition.x) == 0.45f && platePosition.x != previousPlatePosition.x)
+			events.push_back(GameEvent{ GameEvent::WALL_HIT, platePosition });
+
+		for (int i = 0; i < 2; i++) {
+			beltPositions[i].y -= beltSpeed * dt;
+			if (beltPositions[i].y <= -2.4f) {
+				// wrap to the top; the previous state moves along so the jump is not interpolated
+				previousBeltPositions[i].y += 2.4f - beltPositions[i].y;
+				beltPositions[i].y = 2.4f;
+			}
+		}
+
+		// all foods fall and are swept against the moving plate box in one pass
+		unsigned int n = foods.size();
+		float dy = foodSpeed * dt;
+		float plateDx = platePosition.x - previousPlatePosition.x;
+		AABB plateStart = plateShape.at(previousPlatePosition);
+		unsigned int hitCount = stepFoods(foods.arrays(), n, dy, plateStart, plateDx, foods.hits.data());
+		for (unsigned int i = 0; hitCount > 0 && i < n; i++) {
+			if (!foods.hits[i])
+				continue;
+			hitCount--;
+			// the boxes meet during the tick; the hulls decide, tried where the boxes
+			// first touch, halfway through their overlap and where it ends
+			if (narrowphase && !hullsMeet(i, dy, plateStart, plateDx, dt)) {
+				foods.hits[i] = 0;
+				narrowphaseRejects++;
+				continue;
+			}
+			events.push_back(GameEvent{ GameEvent::COLLECTED, glm::vec3(foods.x[i], foods.y[i], foods.z[i]) });
+			// Move off-screen after collision, without sliding there
+			foods.y[i] = foods.prevY[i] = -10.0f;
+			numberOfCollisions++;
+		}
+
+		if (trackPairs)
+			updateBroadphase();
+	}
+
+private:
+	double pastTime = 0.0;
+	double pastDifficulty = 0.0;
+
+	void spawn() {
+		glm::vec3 position = generateRandomPosition(rng);
+		drop(position, generateRandomObject(rng));
+	}
+
+	bool hullsMeet(unsigned int i, float dy, const AABB& plateStart, float plateDx, float dt) const {
+		int t = foods.type[i];
+		AABB start = { glm::vec3(foods.x[i] - foods.halfX[i], foods.prevY[i] + foods.lowY[i], foods.z[i] - foods.halfZ[i]),
+			glm::vec3(foods.x[i] + foods.halfX[i], foods.prevY[i] + foods.highY[i], foods.z[i] + foods.halfZ[i]) };
+		float exit = 1.0f;
+		float enter = std::fmax(timeOfImpact(start, glm::vec3(0.0f, -dy, 0.0f), plateStart, glm::vec3(plateDx, 0.0f, 0.0f), &exit), 0.0f);
+		const float samples[3] = { enter, (enter + exit) * 0.5f, exit };
+		for (int k = 0; k < 3; k++) {
+			float s = samples[k];
+			Placement food = { glm::vec3(foods.x[i], foods.prevY[i] - dy * s, foods.z[i]), foodShapes[t].scale, (float)(time - dt + dt * s) };
+			Placement plate = { previousPlatePosition + glm::vec3(plateDx * s, 0.0f, 0.0f), plateShape.scale, 0.0f };
+			if (gjkIntersect(foodShapes[t].hull, food, plateShape.hull, plate))
+				return true;
+		}
+		return false;
+	}
+
+	// the belt quad is 1.2 x 2.4, drawn just behind the foods
+	static AABB beltAABB(const glm::vec3& position) {
+		return AABB{ position + glm::vec3(-0.60f, -1.20f, -0.01f), position + glm::vec3(0.60f, 1.20f, -0.01f) };
+	}
+
+	void updateBroadphase() {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < foods.size(); i++)
+			broadphase.move(foods.handle(i), foods.box(i));
+		broadphase.move(PLATE_ID, plateShape.at(platePosition));
+		for (int i = 0; i < 2; i++)
+			broadphase.move(BELT_ID + i, beltAABB(beltPositions[i]));
+		broadphase.findPairs(pairs, MAX_PAIRS);
+		droppedPairs = broadphase.droppedPairs;
+		foodFoodPairs = 0;
+		for (unsigned int i = 0; i < pairs.size(); i++)
+			foodFoodPairs += pairs[i].b < MAX_FOODS;
+		broadphaseMicros = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+
+// What the renderer needs from one tick, copied out of the Game so the
+// simulation can go on while the frame is drawn
+struct GameSnapshot {
+	std::vector<Food> foods;
+	glm::vec3 platePosition, previousPlatePosition;
+	glm::vec3 beltPositions[2], previousBeltPositions[2];
+	double time = 0.0;
+	float tickDt = 0.0f;
+	unsigned long long ticks = 0;
+	int level = 1;
+	int numberOfCollisions = 0;
+	int numberOfObject = 0;
+	float foodSpeed = 0.0f;
+	float delay = 0.0f;
+	unsigned int broadphasePairs = 0;
+	unsigned int foodFoodPairs = 0;
+	unsigned int droppedPairs = 0;
+	float broadphaseMicros = 0.0f;
+	// realtime: when the tick was due; lockstep: time left over after the last tick, in ticks
+	std::chrono::steady_clock::time_point tickTime;
+	float alpha = 0.0f;
+	// time the sim thread spent in the ticks since the previous snapshot
+	float simMs = 0.0f;
+
+	// sized for the most foods a game can hold, so a new peak later in the run does not allocate
+	void capture(const Game& game, float dt) {
+		if (foods.capacity() < Game::MAX_FOODS)
+			foods.reserve(Game::MAX_FOODS);
+		foods.resize(game.foods.size());
+		for (unsigned int i = 0; i < game.foods.size(); i++)
+			foods[i] = game.foods.get(i);
+		platePosition = game.platePosition;
+		previousPlatePosition = game.previousPlatePosition;
+		for (int i = 0; i < 2; i++) {
+			beltPositions[i] = game.beltPositions[i];
+			previousBeltPositions[i] = game.previousBeltPositions[i];
+		}
+		time = game.time;
+		tickDt = dt;
+		ticks = game.ticks;
+		level = game.level;
+		numberOfCollisions = game.numberOfCollisions;
+		numberOfObject = game.numberOfObject;
+		foodSpeed = game.foodSpeed;
+		delay = game.delay;
+		broadphasePairs = (unsigned int)game.pairs.size();
+		foodFoodPairs = game.foodFoodPairs;
+		droppedPairs = game.droppedPairs;
+		broadphaseMicros = game.broadphaseMicros;
+	}
+
+	// state between the tick before and this one, alpha in [0, 1]
+	glm::vec3 foodPosition(unsigned int i, float a) const {
+		return glm::mix(foods[i].previous, foods[i].position, a);
+	}
+	glm::vec3 plate(float a) const {
+		return glm::mix(previousPlatePosition, platePosition, a);
+	}
+	glm::vec3 belt(int i, float a) const {
+		return glm::mix(previousBeltPositions[i], beltPositions[i], a);
+	}
+};
+#endif
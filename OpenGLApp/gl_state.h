@@ -0,0 +1,200 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include "stats.h"
+
+// Shadow copy of the GL state the renderer touches (program, VAO, buffers,
+// per-unit textures, blend/depth). Every bind/enable goes through here and is
+// only forwarded to the driver when the value actually changes.
+class GLState
+{
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+	// number of calls forwarded to GL / dropped because they were redundant
+	unsigned long long issued = 0;
+	unsigned long long skipped = 0;
+
+	GLState() { invalidate(); }
+
+	// forget everything we know, e.g. after a new context was made current or
+	// after code outside the cache changed the state
+	// ------------------------------------------------------------------------
+	void invalidate()
+	{
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		for (unsigned int i = 0; i < NUM_BUFFER_TARGETS; i++)
+			buffers[i] = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+			textures[i] = UNKNOWN;
+		for (unsigned int i = 0; i < NUM_CAPS; i++)
+			caps[i] = -1;
+		blendSrc = blendDst = UNKNOWN;
+		depthMaskValue = -1;
+	}
+
+	void resetCounters()
+	{
+		issued = 0;
+		skipped = 0;
+	}
+
+	// ------------------------------------------------------------------------
+	void useProgram(GLuint id)
+	{
+		if (!changed(program, id))
+			return;
+		glUseProgram(id);
+	}
+
+	// ------------------------------------------------------------------------
+	void bindVertexArray(GLuint vao)
+	{
+		if (!changed(vertexArray, vao))
+			return;
+		glBindVertexArray(vao);
+		// the element buffer binding is part of the VAO
+		buffers[ELEMENT_SLOT] = UNKNOWN;
+	}
+
+	// ------------------------------------------------------------------------
+	void bindBuffer(GLenum target, GLuint buffer)
+	{
+		int slot = bufferSlot(target);
+		if (slot < 0) {
+			issued++;
+			glBindBuffer(target, buffer);
+			return;
+		}
+		if (!changed(buffers[slot], buffer))
+			return;
+		glBindBuffer(target, buffer);
+	}
+
+	// binds a 2D texture to the given unit, switching the active unit only if
+	// needed; units past MAX_TEXTURE_UNITS are not cached and always bind
+	// ------------------------------------------------------------------------
+	void bindTexture(unsigned int unit, GLuint texture)
+	{
+		if (unit < MAX_TEXTURE_UNITS) {
+			if (textures[unit] == texture) {
+				skipped++;
+				return;
+			}
+			textures[unit] = texture;
+		}
+		if (activeUnit != unit) {
+			activeUnit = unit;
+			issued++;
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+		issued++;
+		statsRegistry().add(STAT_TEXTURE_BINDS);
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+
+	// ------------------------------------------------------------------------
+	void enable(GLenum cap) { setCap(cap, true); }
+	void disable(GLenum cap) { setCap(cap, false); }
+
+	// ------------------------------------------------------------------------
+	void blendFunc(GLenum src, GLenum dst)
+	{
+		if (blendSrc == src && blendDst == dst) {
+			skipped++;
+			return;
+		}
+		blendSrc = src;
+		blendDst = dst;
+		issued++;
+		glBlendFunc(src, dst);
+	}
+
+	// ------------------------------------------------------------------------
+	void depthMask(bool write)
+	{
+		if (depthMaskValue == (int)write) {
+			skipped++;
+			return;
+		}
+		depthMaskValue = (int)write;
+		issued++;
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+	static const unsigned int NUM_BUFFER_TARGETS = 3;
+	static const unsigned int ELEMENT_SLOT = 1;
+	static const unsigned int NUM_CAPS = 3;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint buffers[NUM_BUFFER_TARGETS];
+	GLuint activeUnit;
+	GLuint textures[MAX_TEXTURE_UNITS];
+	int caps[NUM_CAPS];
+	GLenum blendSrc, blendDst;
+	int depthMaskValue;
+
+	// updates the cached value and tells whether the GL call is needed
+	bool changed(GLuint& cached, GLuint value)
+	{
+		if (cached == value) {
+			skipped++;
+			return false;
+		}
+		cached = value;
+		issued++;
+		return true;
+	}
+
+	static int bufferSlot(GLenum target)
+	{
+		switch (target) {
+		case GL_ARRAY_BUFFER: return 0;
+		case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_SLOT;
+		case GL_DRAW_INDIRECT_BUFFER: return 2;
+		default: return -1;
+		}
+	}
+
+	static int capSlot(GLenum cap)
+	{
+		switch (cap) {
+		case GL_BLEND: return 0;
+		case GL_DEPTH_TEST: return 1;
+		case GL_CULL_FACE: return 2;
+		default: return -1;
+		}
+	}
+
+	void setCap(GLenum cap, bool on)
+	{
+		int slot = capSlot(cap);
+		if (slot >= 0) {
+			if (caps[slot] == (int)on) {
+				skipped++;
+				return;
+			}
+			caps[slot] = (int)on;
+		}
+		issued++;
+		if (on)
+			glEnable(cap);
+		else
+			glDisable(cap);
+	}
+};
+
+// the one state cache shared by every render path of the current context
+inline GLState& glState()
+{
+	static GLState state;
+	return state;
+}
+#endif
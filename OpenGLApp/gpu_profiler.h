@@ -0,0 +1,177 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include "stats.h"
+#include "logging.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// Per-pass GPU timings from GL_TIMESTAMP queries. Every frame gets its own set of
+// queries out of a small ring and is only read back FRAME_LATENCY frames later,
+// when the GPU is done with it, so asking for the results never stalls the
+// pipeline. A frame whose results are still not there is dropped, not waited on.
+class GpuProfiler
+{
+public:
+	static const int FRAME_LATENCY = 4;
+	static const int MAX_SCOPES = 16;
+	// frames averaged together before the stats are published and logged
+	static const int WINDOW = 120;
+
+	struct PassStats {
+		std::string name;
+		double avgMs = 0.0;
+		double maxMs = 0.0;
+		// accumulated over the running window
+		double sumMs = 0.0;
+		double windowMaxMs = 0.0;
+		int samples = 0;
+	};
+
+	bool logToConsole = true;
+	unsigned int droppedFrames = 0;
+
+	void init()
+	{
+		for (int f = 0; f < FRAME_LATENCY; f++) {
+			glGenQueries(MAX_SCOPES * 2, frames[f].queries);
+			frames[f].count = 0;
+			frames[f].pending = false;
+		}
+	}
+
+	void destroy()
+	{
+		for (int f = 0; f < FRAME_LATENCY; f++)
+			glDeleteQueries(MAX_SCOPES * 2, frames[f].queries);
+	}
+
+	// collects the oldest frame in the ring (if the GPU finished it) and reuses its queries
+	void beginFrame()
+	{
+		Frame& frame = frames[frameIndex % FRAME_LATENCY];
+		if (frame.pending)
+			collect(frame);
+		frame.count = 0;
+		frame.pending = false;
+	}
+
+	void endFrame()
+	{
+		Frame& frame = frames[frameIndex % FRAME_LATENCY];
+		frame.pending = frame.count > 0;
+		frameIndex++;
+	}
+
+	// returns a handle for end(), or -1 when the frame has no queries left
+	int begin(const char* name)
+	{
+		Frame& frame = frames[frameIndex % FRAME_LATENCY];
+		if (frame.count >= MAX_SCOPES)
+			return -1;
+		int scope = frame.count++;
+		frame.names[scope] = name;
+		glQueryCounter(frame.queries[scope * 2], GL_TIMESTAMP);
+		return scope;
+	}
+
+	void end(int scope)
+	{
+		if (scope < 0)
+			return;
+		Frame& frame = frames[frameIndex % FRAME_LATENCY];
+		glQueryCounter(frame.queries[scope * 2 + 1], GL_TIMESTAMP);
+	}
+
+	// averages and maxima over the last complete window
+	const std::vector<PassStats>& passes() const { return stats; }
+
+private:
+	struct Frame {
+		GLuint queries[MAX_SCOPES * 2];
+		const char* names[MAX_SCOPES];
+		int count;
+		bool pending;
+	};
+	Frame frames[FRAME_LATENCY];
+	unsigned long long frameIndex = 0;
+	std::vector<PassStats> stats;
+	int windowFrames = 0;
+
+	void collect(Frame& frame)
+	{
+		// scopes nest, so the last query begun is not the last one issued ("frame"
+		// ends after everything in it); every one has to be there before any is read
+		for (int i = 0; i < frame.count * 2; i++) {
+			GLint available = 0;
+			glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				droppedFrames++;
+				return;
+			}
+		}
+		for (int i = 0; i < frame.count; i++) {
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+			double ms = (end - start) / 1.0e6;
+			// the first scope of a frame spans all of it
+			if (i == 0)
+				statsRegistry().gpuFrame(ms);
+			PassStats& pass = find(frame.names[i]);
+			pass.sumMs += ms;
+			pass.samples++;
+			if (ms > pass.windowMaxMs)
+				pass.windowMaxMs = ms;
+		}
+		if (++windowFrames >= WINDOW)
+			publish();
+	}
+
+	PassStats& find(const char* name)
+	{
+		for (unsigned int i = 0; i < stats.size(); i++)
+			if (stats[i].name == name)
+				return stats[i];
+		stats.push_back(PassStats());
+		stats.back().name = name;
+		return stats.back();
+	}
+
+	// the line goes through the async log, the render thread never writes to the console
+	void publish()
+	{
+		char line[512];
+		int length = snprintf(line, sizeof(line), "GPU passes (ms, avg/max over %d frames):", windowFrames);
+		for (unsigned int i = 0; i < stats.size(); i++) {
+			PassStats& pass = stats[i];
+			pass.avgMs = pass.samples ? pass.sumMs / pass.samples : 0.0;
+			pass.maxMs = pass.windowMaxMs;
+			pass.sumMs = 0.0;
+			pass.windowMaxMs = 0.0;
+			pass.samples = 0;
+			if (length >= 0 && length < (int)sizeof(line))
+				length += snprintf(line + length, sizeof(line) - length, "  %s %.3f/%.3f", pass.name.c_str(), pass.avgMs, pass.maxMs);
+		}
+		if (logToConsole)
+			LOG_INFO(PROFILER, "%s", line);
+		windowFrames = 0;
+	}
+};
+
+// Times the GL work issued inside a C++ scope
+class GpuScope
+{
+public:
+	GpuScope(GpuProfiler& profiler, const char* name) : profiler(profiler), scope(profiler.begin(name)) {}
+	~GpuScope() { profiler.end(scope); }
+
+private:
+	GpuProfiler& profiler;
+	int scope;
+};
+#endif
@@ -0,0 +1,254 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "logging.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// GL context without a window or display, for benchmark runs on CI machines.
+// Uses a surfaceless EGL display (Mesa llvmpipe works), so it is Linux only.
+class HeadlessContext
+{
+public:
+	bool create(int major = 3, int minor = 3)
+	{
+#ifdef __linux__
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+		if (getPlatformDisplay)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+		if (display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint eglMajor, eglMinor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+			LOG_ERROR(EGL, "Could not initialize a display");
+			return false;
+		}
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			LOG_ERROR(EGL, "Desktop OpenGL not available");
+			return false;
+		}
+
+		// the default surface type is EGL_WINDOW_BIT, which a surfaceless display has no configs for
+		const EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLConfig config;
+		EGLint numConfigs = 0;
+		if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+			LOG_ERROR(EGL, "No OpenGL config");
+			return false;
+		}
+
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, major,
+			EGL_CONTEXT_MINOR_VERSION, minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+		if (context == EGL_NO_CONTEXT) {
+			LOG_ERROR(EGL, "Failed to create a %d.%d core context", major, minor);
+			return false;
+		}
+		// no surface at all: everything is drawn into an FBO (needs EGL_KHR_surfaceless_context)
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			LOG_ERROR(EGL, "Surfaceless contexts are not supported");
+			return false;
+		}
+		return true;
+#else
+		LOG_ERROR(EGL, "Headless mode is only available on Linux");
+		return false;
+#endif
+	}
+
+	void destroy()
+	{
+#ifdef __linux__
+		if (display == EGL_NO_DISPLAY)
+			return;
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+		eglTerminate(display);
+		display = EGL_NO_DISPLAY;
+		context = EGL_NO_CONTEXT;
+#endif
+	}
+
+	// loader for glad
+	static void* getProcAddress(const char* name)
+	{
+#ifdef __linux__
+		return (void*)eglGetProcAddress(name);
+#else
+		return NULL;
+#endif
+	}
+
+private:
+#ifdef __linux__
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
+
+// Framebuffer object standing in for the window's back buffer
+class OffscreenTarget
+{
+public:
+	unsigned int FBO = 0;
+	int width = 0, height = 0;
+
+	bool create(int w, int h)
+	{
+		width = w;
+		height = h;
+		glGenFramebuffers(1, &FBO);
+		glGenRenderbuffers(1, &colorRBO);
+		glGenRenderbuffers(1, &depthRBO);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR(GL, "Offscreen target is not complete");
+			return false;
+		}
+		glViewport(0, 0, width, height);
+		return true;
+	}
+
+	// RGBA8 pixels, top row first
+	std::vector<unsigned char> readPixels()
+	{
+		std::vector<unsigned char> pixels(width * height * 4);
+		std::vector<unsigned char> flipped(pixels.size());
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		size_t row = width * 4;
+		for (int y = 0; y < height; y++)
+			std::copy(pixels.begin() + y * row, pixels.begin() + (y + 1) * row, flipped.begin() + (height - 1 - y) * row);
+		return flipped;
+	}
+
+	void destroy()
+	{
+		glDeleteFramebuffers(1, &FBO);
+		glDeleteRenderbuffers(1, &colorRBO);
+		glDeleteRenderbuffers(1, &depthRBO);
+	}
+
+private:
+	unsigned int colorRBO = 0, depthRBO = 0;
+};
+
+// Minimal PNG encoder (RGBA8, stored/uncompressed deflate blocks) so frames can
+// be dumped without pulling in another image library
+inline bool writePNG(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba)
+{
+	struct Chunk {
+		static unsigned int crc(const unsigned char* data, size_t len, unsigned int c = 0xFFFFFFFFu) {
+			static unsigned int table[256];
+			static bool ready = false;
+			if (!ready) {
+				for (unsigned int n = 0; n < 256; n++) {
+					unsigned int v = n;
+					for (int k = 0; k < 8; k++)
+						v = v & 1 ? 0xEDB88320u ^ (v >> 1) : v >> 1;
+					table[n] = v;
+				}
+				ready = true;
+			}
+			for (size_t i = 0; i < len; i++)
+				c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+			return c;
+		}
+		static void be32(std::vector<unsigned char>& out, unsigned int v) {
+			out.push_back((v >> 24) & 0xFF);
+			out.push_back((v >> 16) & 0xFF);
+			out.push_back((v >> 8) & 0xFF);
+			out.push_back(v & 0xFF);
+		}
+		static void write(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+			be32(out, (unsigned int)data.size());
+			size_t start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			be32(out, crc(&out[start], out.size() - start) ^ 0xFFFFFFFFu);
+		}
+	};
+
+	// raw scanlines, each prefixed with filter type 0
+	std::vector<unsigned char> raw;
+	raw.reserve((width * 4 + 1) * height);
+	for (int y = 0; y < height; y++) {
+		raw.push_back(0);
+		raw.insert(raw.end(), rgba.begin() + y * width * 4, rgba.begin() + (y + 1) * width * 4);
+	}
+
+	// zlib stream made of stored blocks
+	std::vector<unsigned char> z;
+	z.push_back(0x78);
+	z.push_back(0x01);
+	size_t pos = 0;
+	do {
+		size_t len = std::min<size_t>(65535, raw.size() - pos);
+		z.push_back(pos + len == raw.size() ? 1 : 0);
+		z.push_back(len & 0xFF);
+		z.push_back((len >> 8) & 0xFF);
+		z.push_back(~len & 0xFF);
+		z.push_back((~len >> 8) & 0xFF);
+		z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+		pos += len;
+	} while (pos < raw.size());
+	unsigned int a = 1, b = 0;
+	for (size_t i = 0; i < raw.size(); i++) {
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	Chunk::be32(z, (b << 16) | a);
+
+	std::vector<unsigned char> header;
+	Chunk::be32(header, width);
+	Chunk::be32(header, height);
+	header.push_back(8); // bit depth
+	header.push_back(6); // RGBA
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<unsigned char> file(signature, signature + 8);
+	Chunk::write(file, "IHDR", header);
+	Chunk::write(file, "IDAT", z);
+	Chunk::write(file, "IEND", std::vector<unsigned char>());
+
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if (!out) {
+		LOG_ERROR(PNG, "Could not open %s", path.c_str());
+		return false;
+	}
+	out.write((const char*)file.data(), file.size());
+	return (bool)out;
+}
+#endif
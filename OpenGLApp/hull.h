@@ -0,0 +1,277 @@
+#ifndef HULL_H
+#define HULL_H
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+#include <vector>
+#include <utility>
+#include <cmath>
+
+// Convex hull of a point cloud (quickhull), returned as the hull's vertices.
+// Meant for load time: visibility is found by testing every face, which is
+// simple and fast enough for the few hundred faces a hull of a game model has.
+// Flat or degenerate input gets the corners of its bounding box instead.
+inline std::vector<glm::vec3> quickhull(const std::vector<glm::vec3>& points)
+{
+	struct Face {
+		int v[3];
+		glm::vec3 normal;
+		float offset;
+		std::vector<int> outside;
+		bool dead;
+	};
+
+	std::vector<glm::vec3> hull;
+	if (points.empty())
+		return hull;
+	AABB box = emptyAABB();
+	for (unsigned int i = 0; i < points.size(); i++)
+		expand(box, points[i]);
+	glm::vec3 size = box.max - box.min;
+	const float eps = 1e-5f * std::fmax(size.x, std::fmax(size.y, size.z));
+	std::vector<glm::vec3> corners;
+	for (int i = 0; i < 8; i++)
+		corners.push_back(glm::vec3(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z));
+
+	// initial tetrahedron: two extreme points, the farthest from their line, the farthest from their plane
+	int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < (int)points.size(); i++) {
+		for (int a = 0; a < 3; a++) {
+			if (points[i][a] < points[extremes[a * 2]][a]) extremes[a * 2] = i;
+			if (points[i][a] > points[extremes[a * 2 + 1]][a]) extremes[a * 2 + 1] = i;
+		}
+	}
+	int i0 = extremes[0], i1 = extremes[1];
+	for (int a = 0; a < 3; a++) {
+		if (glm::length(points[extremes[a * 2 + 1]] - points[extremes[a * 2]]) > glm::length(points[i1] - points[i0])) {
+			i0 = extremes[a * 2];
+			i1 = extremes[a * 2 + 1];
+		}
+	}
+	int i2 = -1, i3 = -1;
+	float best = eps;
+	glm::vec3 line = points[i1] - points[i0];
+	for (int i = 0; i < (int)points.size(); i++) {
+		float d = glm::length(glm::cross(points[i] - points[i0], line)) / std::fmax(glm::length(line), eps);
+		if (d > best) { best = d; i2 = i; }
+	}
+	if (i2 < 0)
+		return corners;
+	glm::vec3 planeNormal = glm::normalize(glm::cross(points[i1] - points[i0], points[i2] - points[i0]));
+	best = eps;
+	for (int i = 0; i < (int)points.size(); i++) {
+		float d = std::fabs(glm::dot(points[i] - points[i0], planeNormal));
+		if (d > best) { best = d; i3 = i; }
+	}
+	if (i3 < 0)
+		return corners;
+
+	std::vector<Face> faces;
+	glm::vec3 inside = (points[i0] + points[i1] + points[i2] + points[i3]) * 0.25f;
+	// makes a face with its normal pointing away from the interior point
+	struct Make {
+		static Face face(const std::vector<glm::vec3>& p, int a, int b, int c, const glm::vec3& inside) {
+			Face f;
+			f.normal = glm::normalize(glm::cross(p[b] - p[a], p[c] - p[a]));
+			if (glm::dot(f.normal, inside - p[a]) > 0.0f) {
+				std::swap(b, c);
+				f.normal = -f.normal;
+			}
+			f.v[0] = a; f.v[1] = b; f.v[2] = c;
+			f.offset = glm::dot(f.normal, p[a]);
+			f.dead = false;
+			return f;
+		}
+	};
+	int tetra[4][3] = { { i0, i1, i2 }, { i0, i1, i3 }, { i0, i2, i3 }, { i1, i2, i3 } };
+	for (int f = 0; f < 4; f++)
+		faces.push_back(Make::face(points, tetra[f][0], tetra[f][1], tetra[f][2], inside));
+
+	// every remaining point goes to the first face it lies in front of; points behind all are inside
+	for (int i = 0; i < (int)points.size(); i++) {
+		for (unsigned int f = 0; f < faces.size(); f++) {
+			if (glm::dot(faces[f].normal, points[i]) - faces[f].offset > eps) {
+				faces[f].outside.push_back(i);
+				break;
+			}
+		}
+	}
+
+	for (unsigned int current = 0; current < faces.size(); current++) {
+		if (faces[current].dead || faces[current].outside.empty())
+			continue;
+		// the point farthest out becomes a hull vertex
+		int eye = faces[current].outside[0];
+		float farthest = -1.0f;
+		for (unsigned int k = 0; k < faces[current].outside.size(); k++) {
+			int p = faces[current].outside[k];
+			float d = glm::dot(faces[current].normal, points[p]) - faces[current].offset;
+			if (d > farthest) { farthest = d; eye = p; }
+		}
+
+		// faces it can see, and the edges of that region (its horizon)
+		std::vector<unsigned int> visible;
+		std::vector<std::pair<int, int> > edges;
+		for (unsigned int f = 0; f < faces.size(); f++) {
+			if (faces[f].dead || glm::dot(faces[f].normal, points[eye]) - faces[f].offset <= eps)
+				continue;
+			visible.push_back(f);
+			for (int e = 0; e < 3; e++)
+				edges.push_back(std::make_pair(faces[f].v[e], faces[f].v[(e + 1) % 3]));
+		}
+		std::vector<int> orphans;
+		for (unsigned int k = 0; k < visible.size(); k++) {
+			Face& f = faces[visible[k]];
+			f.dead = true;
+			for (unsigned int o = 0; o < f.outside.size(); o++)
+				if (f.outside[o] != eye)
+					orphans.push_back(f.outside[o]);
+			f.outside.clear();
+		}
+
+		// an edge is on the horizon when its twin does not belong to a visible face
+		unsigned int firstNew = (unsigned int)faces.size();
+		for (unsigned int k = 0; k < edges.size(); k++) {
+			bool shared = false;
+			for (unsigned int m = 0; m < edges.size() && !shared; m++)
+				shared = edges[m].first == edges[k].second && edges[m].second == edges[k].first;
+			if (!shared)
+				faces.push_back(Make::face(points, edges[k].first, edges[k].second, eye, inside));
+		}
+		for (unsigned int k = 0; k < orphans.size(); k++) {
+			for (unsigned int f = firstNew; f < faces.size(); f++) {
+				if (glm::dot(faces[f].normal, points[orphans[k]]) - faces[f].offset > eps) {
+					faces[f].outside.push_back(orphans[k]);
+					break;
+				}
+			}
+		}
+		// the new faces come after current, so the scan reaches them
+	}
+
+	std::vector<char> used(points.size(), 0);
+	for (unsigned int f = 0; f < faces.size(); f++) {
+		if (faces[f].dead)
+			continue;
+		for (int e = 0; e < 3; e++) {
+			if (!used[faces[f].v[e]]) {
+				used[faces[f].v[e]] = 1;
+				hull.push_back(points[faces[f].v[e]]);
+			}
+		}
+	}
+	return hull;
+}
+
+// Where a convex shape is drawn: translate * scale * rotate about y, the same
+// transform the renderer builds for a food
+struct Placement {
+	glm::vec3 position;
+	glm::vec3 scale;
+	float angle;
+};
+
+// farthest hull point along world direction d, in world space
+inline glm::vec3 supportPoint(const std::vector<glm::vec3>& hull, const Placement& at, const glm::vec3& d)
+{
+	float c = std::cos(at.angle), s = std::sin(at.angle);
+	// direction taken back into the hull's own space: R^T * S * d
+	glm::vec3 sd = d * at.scale;
+	glm::vec3 local(c * sd.x - s * sd.z, sd.y, s * sd.x + c * sd.z);
+	unsigned int best = 0;
+	float bestDot = glm::dot(hull[0], local);
+	for (unsigned int i = 1; i < hull.size(); i++) {
+		float dd = glm::dot(hull[i], local);
+		if (dd > bestDot) { bestDot = dd; best = i; }
+	}
+	const glm::vec3& p = hull[best];
+	return at.position + at.scale * glm::vec3(c * p.x + s * p.z, p.y, -s * p.x + c * p.z);
+}
+
+// GJK boolean test: true when the two placed convex hulls overlap
+inline bool gjkIntersect(const std::vector<glm::vec3>& hullA, const Placement& atA, const std::vector<glm::vec3>& hullB, const Placement& atB)
+{
+	if (hullA.empty() || hullB.empty())
+		return false;
+	struct Minkowski {
+		const std::vector<glm::vec3>& a; const Placement& pa;
+		const std::vector<glm::vec3>& b; const Placement& pb;
+		glm::vec3 operator()(const glm::vec3& d) const { return supportPoint(a, pa, d) - supportPoint(b, pb, -d); }
+	} support = { hullA, atA, hullB, atB };
+
+	glm::vec3 a, b, c, d;
+	glm::vec3 dir = atA.position - atB.position;
+	if (glm::dot(dir, dir) < 1e-12f)
+		dir = glm::vec3(1.0f, 0.0f, 0.0f);
+	c = support(dir);
+	dir = -c;
+	b = support(dir);
+	if (glm::dot(b, dir) < 0.0f)
+		return false;
+	// towards the origin, perpendicular to the segment bc
+	dir = glm::cross(glm::cross(c - b, -b), c - b);
+	if (glm::dot(dir, dir) < 1e-12f) {
+		dir = glm::cross(c - b, glm::vec3(1.0f, 0.0f, 0.0f));
+		if (glm::dot(dir, dir) < 1e-12f)
+			dir = glm::cross(c - b, glm::vec3(0.0f, 0.0f, -1.0f));
+	}
+	int dim = 2;
+
+	for (int iteration = 0; iteration < 64; iteration++) {
+		a = support(dir);
+		if (glm::dot(a, dir) < 0.0f)
+			return false; // the new point did not pass the origin, so the difference cannot contain it
+		dim++;
+		glm::vec3 ao = -a;
+		if (dim == 3) {
+			// triangle abc: keep the feature closest to the origin
+			glm::vec3 n = glm::cross(b - a, c - a);
+			dim = 2;
+			if (glm::dot(glm::cross(b - a, n), ao) > 0.0f) {
+				c = a;
+				dir = glm::cross(glm::cross(b - a, ao), b - a);
+				continue;
+			}
+			if (glm::dot(glm::cross(n, c - a), ao) > 0.0f) {
+				b = a;
+				dir = glm::cross(glm::cross(c - a, ao), c - a);
+				continue;
+			}
+			dim = 3;
+			if (glm::dot(n, ao) > 0.0f) {
+				d = c; c = b; b = a;
+				dir = n;
+			}
+			else {
+				d = b; b = a;
+				dir = -n;
+			}
+			continue;
+		}
+		// tetrahedron abcd: origin inside unless it is in front of one of the faces through a
+		glm::vec3 abc = glm::cross(b - a, c - a);
+		glm::vec3 acd = glm::cross(c - a, d - a);
+		glm::vec3 adb = glm::cross(d - a, b - a);
+		dim = 3;
+		if (glm::dot(abc, ao) > 0.0f) {
+			d = c; c = b; b = a;
+			dir = abc;
+			continue;
+		}
+		if (glm::dot(acd, ao) > 0.0f) {
+			b = a;
+			dir = acd;
+			continue;
+		}
+		if (glm::dot(adb, ao) > 0.0f) {
+			c = d; d = b; b = a;
+			dir = adb;
+			continue;
+		}
+		return true;
+	}
+	return false;
+}
+#endif
@@ -0,0 +1,104 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "logging.h"
+#include "byte_order.h"
+
+// The plate direction of every tick of a session, plus the seed and tick rate
+// it ran with: all a Game needs to play the same session again. On disk it is
+// a small header followed by run-length encoded directions, since the plate
+// keeps one direction for many ticks at a time:
+//
+//   "FRPL", version, seed, tick rate (u32), tick count (u64), then per run
+//   one byte direction + 1 and the run length as a LEB128 varint
+//
+// all little endian. Replaying needs the game to spawn the same foods from the
+// seed on every build, which is why generateRandomPosition/Object draw from
+// the raw mt19937 output instead of a std distribution; the version goes up
+// whenever the spawn rules change, since an old recording would then play a
+// different session.
+class InputRecording {
+public:
+	unsigned int seed = 0;
+	unsigned int tickRate = 60;
+	std::vector<signed char> directions; // one per tick
+
+	void record(int direction) { directions.push_back((signed char)direction); }
+	unsigned long long ticks() const { return directions.size(); }
+	// the plate stands still past the end
+	int direction(unsigned long long tick) const { return tick < directions.size() ? directions[(size_t)tick] : 0; }
+
+	bool save(const std::string& path) const {
+		std::vector<unsigned char> bytes;
+		bytes.push_back('F'); bytes.push_back('R'); bytes.push_back('P'); bytes.push_back('L');
+		putLE(bytes, VERSION, 4);
+		putLE(bytes, seed, 4);
+		putLE(bytes, tickRate, 4);
+		putLE(bytes, directions.size(), 8);
+		for (size_t i = 0; i < directions.size();) {
+			size_t run = 1;
+			while (i + run < directions.size() && directions[i + run] == directions[i])
+				run++;
+			bytes.push_back((unsigned char)(directions[i] + 1));
+			for (unsigned long long n = run; ; n >>= 7) {
+				bytes.push_back((unsigned char)((n & 0x7F) | (n >= 0x80 ? 0x80 : 0)));
+				if (n < 0x80)
+					break;
+			}
+			i += run;
+		}
+		std::ofstream file(path, std::ios::binary);
+		file.write((const char*)bytes.data(), bytes.size());
+		if (!file) {
+			LOG_ERROR(RECORDING, "could not write %s", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool load(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (!file.is_open() || bytes.size() < 24 || bytes[0] != 'F' || bytes[1] != 'R' || bytes[2] != 'P' || bytes[3] != 'L') {
+			LOG_ERROR(RECORDING, "%s is not an input recording", path.c_str());
+			return false;
+		}
+		if (getLE(bytes, 4, 4) != VERSION) {
+			LOG_ERROR(RECORDING, "%s has an unknown version", path.c_str());
+			return false;
+		}
+		seed = (unsigned int)getLE(bytes, 8, 4);
+		tickRate = (unsigned int)getLE(bytes, 12, 4);
+		unsigned long long count = getLE(bytes, 16, 8);
+		directions.clear();
+		size_t at = 24;
+		while (at < bytes.size() && directions.size() < count) {
+			signed char direction = (signed char)(bytes[at++] - 1);
+			unsigned long long run = 0;
+			for (int shift = 0; at < bytes.size() && shift < 64; shift += 7) {
+				unsigned char b = bytes[at++];
+				run |= (unsigned long long)(b & 0x7F) << shift;
+				if (!(b & 0x80))
+					break;
+			}
+			if (direction < -1 || direction > 1 || run > count - directions.size())
+				break;
+			directions.insert(directions.end(), (size_t)run, direction);
+		}
+		if (directions.size() != count || tickRate == 0) {
+			LOG_ERROR(RECORDING, "%s is truncated or corrupt", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	enum : unsigned int { VERSION = 2 }; // 2: tick-rate independent spawns, portable spawn draws
+};
+#endif
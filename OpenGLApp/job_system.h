@@ -0,0 +1,289 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "profiler.h"
+
+class JobSystem;
+
+// Counts the unfinished jobs of a group. JobSystem::wait() on it returns once
+// they are all done, and jobs queued with JobSystem::runAfter() start then.
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	// once true, no job touches the counter again and it may go out of scope
+	bool done() const { return pending.load() == 0 && finishing.load() == 0; }
+
+private:
+	friend class JobSystem;
+	struct Continuation {
+		std::function<void()> task;
+		JobCounter* counter;
+	};
+	std::atomic<int> pending{ 0 };
+	std::atomic<int> finishing{ 0 }; // jobs between their decrement and their last access
+	std::mutex mutex;
+	std::vector<Continuation> continuations;
+};
+
+// Work-stealing scheduler. Every thread, the one that made the JobSystem
+// included, has its own deque: it pushes and pops new work at the back, while
+// idle threads steal the oldest work from the front of someone else's. The
+// main thread takes part whenever it waits on a counter, so a frame can hand
+// out its loops and help finish them instead of blocking.
+//
+//   JobCounter counter;
+//   jobs.parallelFor(count, 256, [&](unsigned int begin, unsigned int end) { ... }); // returns when done
+//   jobs.run([&] { ... }, &counter);
+//   jobs.runAfter(counter, [&] { ... }, &other);  // starts once counter is done
+//   jobs.wait(other);
+class JobSystem {
+public:
+	// threads counts the main thread; 0 means one per hardware thread
+	explicit JobSystem(unsigned int threads = 0) {
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		queues.reserve(threads);
+		for (unsigned int i = 0; i < threads; i++)
+			queues.push_back(std::unique_ptr<Queue>(new Queue()));
+		for (unsigned int i = 1; i < threads; i++)
+			workers.push_back(std::thread(&JobSystem::work, this, i));
+	}
+
+	~JobSystem() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			quit = true;
+		}
+		sleep.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned int threads() const { return (unsigned int)queues.size(); }
+
+	// queues task; counter, if given, counts it until it has run
+	void run(std::function<void()> task, JobCounter* counter = nullptr) {
+		Job job;
+		job.function = &runTask;
+		job.data = new std::function<void()>(std::move(task));
+		job.begin = job.end = 0;
+		job.counter = counter;
+		if (counter)
+			counter->pending.fetch_add(1);
+		push(job);
+	}
+
+	// queues task once every job counted by dependency has finished
+	void runAfter(JobCounter& dependency, std::function<void()> task, JobCounter* counter = nullptr) {
+		if (counter)
+			counter->pending.fetch_add(1);
+		{
+			std::lock_guard<std::mutex> lock(dependency.mutex);
+			if (dependency.pending.load() != 0) {
+				dependency.continuations.push_back(JobCounter::Continuation{ std::move(task), counter });
+				return;
+			}
+		}
+		run(std::move(task), counter);
+		if (counter)
+			counter->pending.fetch_sub(1);
+	}
+
+	// runs queued jobs until counter is done
+	void wait(JobCounter& counter) {
+		unsigned int self = currentQueue();
+		while (!counter.done()) {
+			Job job;
+			if (take(self, job))
+				execute(job);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	// calls body(begin, end) over [0, count) in chunks of at most grain, on every
+	// thread, and returns when all have run. Small loops run inline.
+	template <typename Body>
+	void parallelFor(unsigned int count, unsigned int grain, const Body& body) {
+		grain = std::max(1u, grain);
+		if (count <= grain || queues.size() == 1) {
+			if (count > 0)
+				body(0, count);
+			return;
+		}
+		JobCounter counter;
+		unsigned int chunks = (count + grain - 1) / grain;
+		counter.pending.store((int)chunks - 1);
+		// the last chunk is this thread's; the others go on its queue for anyone to take
+		for (unsigned int c = chunks - 1; c > 0; c--) {
+			Job job;
+			job.function = &runRange<Body>;
+			job.data = (void*)&body;
+			job.begin = (c - 1) * grain;
+			job.end = std::min(count, c * grain);
+			job.counter = &counter;
+			push(job);
+		}
+		body((chunks - 1) * grain, count);
+		wait(counter);
+	}
+
+private:
+	struct Job {
+		void (*function)(void* data, unsigned int begin, unsigned int end);
+		void* data;
+		unsigned int begin, end;
+		JobCounter* counter;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::unique_ptr<Queue> > queues;
+	std::vector<std::thread> workers;
+	std::atomic<int> queued{ 0 };
+	std::atomic<int> sleepers{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable sleep;
+	bool quit = false;
+
+	static void runTask(void* data, unsigned int, unsigned int) {
+		std::function<void()>* task = (std::function<void()>*)data;
+		(*task)();
+		delete task;
+	}
+
+	template <typename Body>
+	static void runRange(void* data, unsigned int begin, unsigned int end) {
+		(*(const Body*)data)(begin, end);
+	}
+
+	// the worker this thread is; the thread_local is shared by every JobSystem,
+	// so it names the one the index belongs to
+	struct ThreadQueue {
+		const JobSystem* owner;
+		unsigned int index;
+	};
+	static ThreadQueue& threadQueue() {
+		static thread_local ThreadQueue queue = { nullptr, 0 };
+		return queue;
+	}
+	// this thread's queue: a worker's own, 0 for the main thread and any other,
+	// workers of another JobSystem (a job that drives a BatchSim) included
+	unsigned int currentQueue() const {
+		const ThreadQueue& queue = threadQueue();
+		return queue.owner == this ? queue.index : 0;
+	}
+
+	void push(const Job& job) {
+		Queue& queue = *queues[currentQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+		}
+		// a worker counts itself as sleeping before it checks queued, so one of
+		// the two always sees the other and no wake-up is lost
+		queued.fetch_add(1);
+		if (sleepers.load() > 0) {
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			sleep.notify_one();
+		}
+	}
+
+	// newest job of our own queue, else the oldest of someone else's
+	bool take(unsigned int self, Job& job) {
+		if (queued.load(std::memory_order_acquire) == 0)
+			return false;
+		{
+			Queue& own = *queues[self];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.jobs.empty()) {
+				job = own.jobs.back();
+				own.jobs.pop_back();
+				queued.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		for (unsigned int i = 1; i < queues.size(); i++) {
+			Queue& victim = *queues[(self + i) % queues.size()];
+			std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+			if (lock.owns_lock() && !victim.jobs.empty()) {
+				job = victim.jobs.front();
+				victim.jobs.pop_front();
+				queued.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void execute(const Job& job) {
+		job.function(job.data, job.begin, job.end);
+		if (job.counter)
+			finish(*job.counter);
+	}
+
+	void finish(JobCounter& counter) {
+		counter.finishing.fetch_add(1);
+		if (counter.pending.fetch_sub(1) == 1) {
+			// the last one out; runAfter() sees pending at 0 from here on and runs its task itself
+			std::vector<JobCounter::Continuation> ready;
+			{
+				std::lock_guard<std::mutex> lock(counter.mutex);
+				ready.swap(counter.continuations);
+			}
+			for (unsigned int i = 0; i < ready.size(); i++) {
+				run(std::move(ready[i].task), ready[i].counter);
+				if (ready[i].counter)
+					ready[i].counter->pending.fetch_sub(1);
+			}
+		}
+		counter.finishing.fetch_sub(1);
+	}
+
+	void work(unsigned int index) {
+		threadQueue().owner = this;
+		threadQueue().index = index;
+		PROFILE_THREAD("worker " + std::to_string(index));
+		unsigned int idle = 0;
+		for (;;) {
+			Job job;
+			if (take(index, job)) {
+				execute(job);
+				idle = 0;
+				continue;
+			}
+			// spin briefly, a frame's next loop is usually moments away
+			if (++idle < 64) {
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepers.fetch_add(1);
+			sleep.wait(lock, [this] { return quit || queued.load() > 0; });
+			sleepers.fetch_sub(1);
+			if (quit)
+				return;
+			idle = 0;
+		}
+	}
+};
+#endif
@@ -0,0 +1,2 @@
+#define LOGGING_IMPLEMENTATION
+#include "logging.h"
\ No newline at end of file
@@ -0,0 +1,364 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+// Logging through the bundled dlg headers. Only dlg's headers are vendored, so
+// this file supplies the library side (compiled once, in logging.cpp), and
+// makes it asynchronous: a log call formats into a thread-local buffer and
+// copies the line into a ring owned by the calling thread; a writer thread
+// drains every ring and hands the lines, in time order, to the dlg handler.
+// No log call ever touches a file or takes a lock. A full ring drops the line
+// and counts it.
+//
+//   LOG_ERROR(SOUND, "could not open %s", path.c_str());
+//
+// prints "ERROR::SOUND: could not open ...". Levels below DLG_LOG_LEVEL and
+// tags missing from the LOG_TAGS mask are removed at compile time.
+#ifndef DLG_LOG_LEVEL
+#ifdef NDEBUG
+#define DLG_LOG_LEVEL dlg_level_info
+#else
+#define DLG_LOG_LEVEL dlg_level_debug
+#endif
+#endif
+#ifndef DLG_STATIC
+#define DLG_STATIC
+#endif
+#include "dlg/dlg.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+
+enum LogTag : unsigned int {
+	LOG_TAG_APP = 1 << 0,
+	LOG_TAG_GAME = 1 << 1,
+	LOG_TAG_GL = 1 << 2,
+	LOG_TAG_SHADER = 1 << 3,
+	LOG_TAG_ASSIMP = 1 << 4,
+	LOG_TAG_FREETYPE = 1 << 5,
+	LOG_TAG_EGL = 1 << 6,
+	LOG_TAG_PNG = 1 << 7,
+	LOG_TAG_RECORDING = 1 << 8,
+	LOG_TAG_SOUND = 1 << 9,
+	LOG_TAG_PROFILER = 1 << 10,
+	LOG_TAG_TELEMETRY = 1 << 11,
+	LOG_TAG_TEXTURE = 1 << 12,
+	LOG_TAG_MEMORY = 1 << 13,
+};
+
+#ifndef LOG_TAGS
+#define LOG_TAGS 0xFFFFFFFFu
+#endif
+
+#define LOG_AT(level, tag, ...) do { if ((level) >= DLG_LOG_LEVEL && ((LOG_TAGS) & LOG_TAG_##tag)) { dlg_logt(level, (#tag), __VA_ARGS__); } } while (0)
+#define LOG_TRACE(tag, ...) LOG_AT(dlg_level_trace, tag, __VA_ARGS__)
+#define LOG_DEBUG(tag, ...) LOG_AT(dlg_level_debug, tag, __VA_ARGS__)
+#define LOG_INFO(tag, ...) LOG_AT(dlg_level_info, tag, __VA_ARGS__)
+#define LOG_WARN(tag, ...) LOG_AT(dlg_level_warn, tag, __VA_ARGS__)
+#define LOG_ERROR(tag, ...) LOG_AT(dlg_level_error, tag, __VA_ARGS__)
+
+// What a log call leaves in its thread's ring; strings other than the text
+// are literals and outlive it.
+struct LogRecord {
+	long long time; // ns since the log started
+	dlg_level level;
+	const char* tags[4]; // null-terminated
+	const char* file;
+	unsigned int line;
+	const char* func;
+	const char* expr;
+	char text[960];  // truncated beyond this; fits a shader info log
+};
+
+class AsyncLog {
+public:
+	// lines go to stdout, and to path as well when it is not empty
+	bool start(const std::string& path)
+	{
+		if (!path.empty()) {
+			file.open(path);
+			if (!file)
+				LOG_ERROR(APP, "could not write %s", path.c_str());
+		}
+		running.store(true, std::memory_order_release);
+		writer = std::thread(&AsyncLog::run, this);
+		return true;
+	}
+
+	// drains what is left, then returns
+	void stop()
+	{
+		running.store(false, std::memory_order_release);
+		if (writer.joinable())
+			writer.join();
+		drain();
+		if (file.is_open())
+			file.close();
+	}
+
+	long long now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	// calling thread; false when its ring was full
+	bool push(const LogRecord& record)
+	{
+		ThreadRing& ring = threadRing();
+		size_t w = ring.written.load(std::memory_order_relaxed);
+		if (w - ring.read.load(std::memory_order_acquire) == RING) {
+			ring.dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		ring.records[w & (RING - 1)] = record;
+		ring.written.store(w + 1, std::memory_order_release);
+		return true;
+	}
+
+	// writer thread: one finished line
+	void write(const std::string& line)
+	{
+		std::fwrite(line.data(), 1, line.size(), stdout);
+		if (file.is_open())
+			file << line;
+	}
+
+	unsigned long long dropped()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		unsigned long long total = 0;
+		for (unsigned int i = 0; i < rings.size(); i++)
+			total += rings[i]->dropped.load(std::memory_order_relaxed);
+		return total;
+	}
+
+private:
+	enum : unsigned int { RING = 128 }; // lines per thread, 128 KB
+
+	struct ThreadRing {
+		std::vector<LogRecord> records;
+		std::atomic<size_t> written{ 0 };
+		std::atomic<size_t> read{ 0 };
+		std::atomic<unsigned long long> dropped{ 0 };
+	};
+
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::atomic<bool> running{ false };
+	std::thread writer;
+	std::ofstream file;
+	std::mutex mutex; // guards rings, taken once per thread and by the writer
+	std::vector<std::unique_ptr<ThreadRing> > rings;
+	std::vector<LogRecord> batch;
+
+	ThreadRing& threadRing()
+	{
+		static thread_local ThreadRing* ring = nullptr;
+		if (!ring) {
+			std::unique_ptr<ThreadRing> created(new ThreadRing());
+			created->records.resize(RING);
+			std::lock_guard<std::mutex> lock(mutex);
+			ring = created.get();
+			rings.push_back(std::move(created));
+		}
+		return *ring;
+	}
+
+	void run()
+	{
+		while (running.load(std::memory_order_acquire)) {
+			drain();
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+
+	// every ring's lines, merged by time, through the dlg handler
+	void drain()
+	{
+		batch.clear();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (unsigned int i = 0; i < rings.size(); i++) {
+				ThreadRing& ring = *rings[i];
+				size_t r = ring.read.load(std::memory_order_relaxed);
+				size_t w = ring.written.load(std::memory_order_acquire);
+				for (; r != w; r++)
+					batch.push_back(ring.records[r & (RING - 1)]);
+				ring.read.store(r, std::memory_order_release);
+			}
+		}
+		if (batch.empty())
+			return;
+		std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) { return a.time < b.time; });
+		void* data = nullptr;
+		dlg_handler handler = dlg_get_handler(&data);
+		for (unsigned int i = 0; i < batch.size(); i++) {
+			LogRecord& record = batch[i];
+			dlg_origin origin = { record.file, record.line, record.func, record.level, record.tags, record.expr };
+			if (handler)
+				handler(&origin, record.text, data);
+		}
+		std::fflush(stdout);
+		if (file.is_open())
+			file.flush();
+	}
+};
+
+inline AsyncLog& asyncLog()
+{
+	static AsyncLog instance;
+	return instance;
+}
+
+// Runs the log writer for as long as it lives; main() keeps one, so every
+// return path flushes what was logged.
+class LogSession {
+public:
+	explicit LogSession(const std::string& path = "") { asyncLog().start(path); }
+	~LogSession() { asyncLog().stop(); }
+	LogSession(const LogSession&) = delete;
+	LogSession& operator=(const LogSession&) = delete;
+};
+#endif
+
+#if defined(LOGGING_IMPLEMENTATION) && !defined(LOGGING_DEFINED)
+#define LOGGING_DEFINED
+// The dlg library functions dlg.h declares
+namespace {
+	dlg_handler logHandler = dlg_default_output;
+	void* logHandlerData = nullptr;
+
+	struct ThreadTag {
+		const char* tag;
+		const char* func;
+	};
+	thread_local ThreadTag threadTags[8];
+	thread_local unsigned int threadTagCount = 0;
+	thread_local char* threadBuffer = nullptr;
+	thread_local size_t threadBufferSize = 0;
+
+	const char* levelName(dlg_level level)
+	{
+		static const char* names[] = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "FATAL" };
+		return level >= dlg_level_trace && level <= dlg_level_fatal ? names[level] : "LOG";
+	}
+}
+
+extern "C" {
+
+const char* dlg__printf_format(const char* format, ...)
+{
+	size_t* size;
+	char** buffer = dlg_thread_buffer(&size);
+	va_list args;
+	va_start(args, format);
+	int needed = std::vsnprintf(*buffer, *size, format, args);
+	va_end(args);
+	if (needed >= 0 && (size_t)needed >= *size) {
+		// once per thread at most, lines are short
+		char* grown = (char*)std::realloc(*buffer, needed + 1);
+		if (grown) {
+			*buffer = grown;
+			*size = needed + 1;
+			va_start(args, format);
+			std::vsnprintf(*buffer, *size, format, args);
+			va_end(args);
+		}
+	}
+	return *buffer;
+}
+
+void dlg__do_log(enum dlg_level level, const char* const* tags, const char* file, int line,
+	const char* func, const char* string, const char* expr)
+{
+	LogRecord record;
+	record.time = asyncLog().now();
+	record.level = level;
+	record.file = file;
+	record.line = (unsigned int)line;
+	record.func = func;
+	record.expr = expr;
+	// without default tags the list starts with a null
+	unsigned int count = 0;
+	if (!*tags)
+		tags++;
+	for (; *tags && count < 3; tags++)
+		record.tags[count++] = *tags;
+	for (unsigned int i = 0; i < threadTagCount && count < 3; i++)
+		if (!threadTags[i].func || std::strcmp(threadTags[i].func, func) == 0)
+			record.tags[count++] = threadTags[i].tag;
+	record.tags[count] = nullptr;
+	std::snprintf(record.text, sizeof(record.text), "%s", string ? string : "");
+	asyncLog().push(record);
+}
+
+const char* dlg__strip_root_path(const char* file, const char* base)
+{
+	size_t length = std::strlen(base);
+	return std::strncmp(file, base, length) == 0 ? file + length : file;
+}
+
+void dlg_set_handler(dlg_handler handler, void* data)
+{
+	logHandler = handler;
+	logHandlerData = data;
+}
+
+dlg_handler dlg_get_handler(void** data)
+{
+	*data = logHandlerData;
+	return logHandler;
+}
+
+// "LEVEL::TAG: text", the form the ERROR:: messages always had
+void dlg_default_output(const struct dlg_origin* origin, const char* string, void*)
+{
+	std::string line = levelName(origin->level);
+	for (const char** tag = origin->tags; tag && *tag; tag++)
+		line += std::string("::") + *tag;
+	line += ": ";
+	if (origin->expr)
+		line += std::string("assertion '") + origin->expr + "' failed" + (*string ? ": " : "");
+	line += string;
+	line += '\n';
+	asyncLog().write(line);
+}
+
+void dlg_add_tag(const char* tag, const char* func)
+{
+	if (threadTagCount < 8)
+		threadTags[threadTagCount++] = ThreadTag{ tag, func };
+}
+
+bool dlg_remove_tag(const char* tag, const char* func)
+{
+	for (unsigned int i = 0; i < threadTagCount; i++) {
+		if (threadTags[i].tag == tag && threadTags[i].func == func) {
+			threadTags[i] = threadTags[--threadTagCount];
+			return true;
+		}
+	}
+	return false;
+}
+
+char** dlg_thread_buffer(size_t** size)
+{
+	if (!threadBuffer) {
+		threadBufferSize = 256;
+		threadBuffer = (char*)std::malloc(threadBufferSize);
+	}
+	*size = &threadBufferSize;
+	return &threadBuffer;
+}
+
+}
+#endif
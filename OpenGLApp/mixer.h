@@ -0,0 +1,231 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include "voice_pool.h"
+#include "mixer_kernels.h"
+#include "music_stream.h"
+#include "audio_output.h"
+#include "event_ring.h"
+#include "profiler.h"
+#include "logging.h"
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// Software mixer: a VoicePool backend that mixes its voices, plus an optional
+// streamed music track, into a stereo float buffer. The pool drives it from
+// the audio thread through a command ring; mix() runs on the mixer thread, so
+// neither side ever locks. Clips are converted to the mixer's sample rate
+// once, when uploaded.
+class Mixer : public AudioBackend {
+public:
+	float musicGain = 0.35f;
+	MusicStream* music = nullptr; // set before mixing starts
+
+	explicit Mixer(unsigned int sampleRate = 44100, unsigned int voices = 8)
+		: rate(sampleRate), generations(voices, 0), ended(voices), playing(voices)
+	{
+		for (unsigned int v = 0; v < voices; v++)
+			ended[v].store(0, std::memory_order_relaxed);
+	}
+
+	unsigned int sampleRate() const { return rate; }
+
+	bool upload(unsigned short id, const SoundClip& clip) override
+	{
+		if (id >= SOUND_COUNT || clip.channels == 0 || clip.channels > 2) {
+			LOG_ERROR(SOUND, "the mixer plays mono and stereo sounds only");
+			return false;
+		}
+		clips[id] = clip;
+		if (clip.sampleRate != rate)
+			resample(clips[id]);
+		return true;
+	}
+
+	void start(unsigned int voice, unsigned short id, float gain, float pan) override
+	{
+		// constant power pan
+		float angle = (pan + 1.0f) * 0.785398163f;
+		Command command = { Command::START, voice, id, ++generations[voice], gain * std::cos(angle) / 32768.0f, gain * std::sin(angle) / 32768.0f };
+		if (!commands.push(command))
+			generations[voice]--; // never started, the voice stays as it was
+	}
+
+	void stop(unsigned int voice) override
+	{
+		Command command = { Command::STOP, voice, 0, generations[voice], 0.0f, 0.0f };
+		commands.push(command);
+	}
+
+	// the voice's last start has played out or was stopped
+	bool finished(unsigned int voice) override
+	{
+		return ended[voice].load(std::memory_order_acquire) == generations[voice];
+	}
+
+	// mixer thread: the next frames of interleaved stereo, -1..1
+	void mix(float* out, unsigned int frames)
+	{
+		Command command;
+		while (commands.pop(command)) {
+			Playing& p = playing[command.voice];
+			if (command.type == Command::START) {
+				// a voice restarted before its old sound ended drops that one
+				p.clip = &clips[command.id];
+				p.frame = 0;
+				p.gainL = command.gainL;
+				p.gainR = command.gainR;
+				p.generation = command.generation;
+			}
+			else if (p.clip && p.generation == command.generation) {
+				p.clip = nullptr;
+				ended[command.voice].store(p.generation, std::memory_order_release);
+			}
+		}
+
+		std::fill(out, out + frames * 2, 0.0f);
+		for (unsigned int v = 0; v < playing.size(); v++) {
+			Playing& p = playing[v];
+			if (!p.clip)
+				continue;
+			unsigned int count = std::min(frames, p.clip->frames() - p.frame);
+			mixVoice(out, &p.clip->samples[p.frame * p.clip->channels], p.clip->channels, count, p.gainL, p.gainR);
+			p.frame += count;
+			if (p.frame >= p.clip->frames()) {
+				p.clip = nullptr;
+				ended[v].store(p.generation, std::memory_order_release);
+			}
+		}
+
+		if (music) {
+			musicBuffer.resize(frames * 2);
+			unsigned int got = music->read(musicBuffer.data(), frames);
+			float gain = musicGain / 32768.0f;
+			mixVoice(out, musicBuffer.data(), music->channels(), got, gain, gain);
+		}
+	}
+
+private:
+	struct Command {
+		enum Type : unsigned int { START, STOP } type;
+		unsigned int voice;
+		unsigned short id;
+		unsigned int generation;
+		float gainL, gainR;
+	};
+	struct Playing {
+		const SoundClip* clip = nullptr;
+		unsigned int frame = 0;
+		float gainL = 0.0f, gainR = 0.0f;
+		unsigned int generation = 0;
+	};
+
+	unsigned int rate;
+	SoundClip clips[SOUND_COUNT];
+	EventRing<Command, 64> commands;
+	// audio thread side: starts per voice; mixer side: the last one that ended
+	std::vector<unsigned int> generations;
+	std::vector<std::atomic<unsigned int> > ended;
+	std::vector<Playing> playing;
+	std::vector<short> musicBuffer;
+
+	// linear interpolation, good enough for short effects
+	void resample(SoundClip& clip) const
+	{
+		unsigned int frames = clip.frames();
+		unsigned int outFrames = (unsigned int)((unsigned long long)frames * rate / clip.sampleRate);
+		std::vector<short> out(outFrames * clip.channels);
+		double step = (double)clip.sampleRate / rate;
+		for (unsigned int i = 0; i < outFrames; i++) {
+			double at = i * step;
+			unsigned int a = (unsigned int)at;
+			unsigned int b = std::min(a + 1, frames - 1);
+			float t = (float)(at - a);
+			for (unsigned int c = 0; c < clip.channels; c++)
+				out[i * clip.channels + c] = (short)std::lrint(clip.samples[a * clip.channels + c] * (1.0f - t) + clip.samples[b * clip.channels + c] * t);
+		}
+		clip.samples.swap(out);
+		clip.sampleRate = rate;
+	}
+};
+
+// Pulls buffers from a Mixer and hands them to an AudioOutput on a thread of
+// its own. Every buffer is one "callback"; its mixing cost is measured against
+// the time the buffer lasts, and underruns of the device and the music stream
+// are counted, so heavy load shows up as numbers instead of crackles.
+class MixerThread {
+public:
+	MixerThread(Mixer& mixer, AudioOutput& output, unsigned int framesPerBuffer = 512)
+		: mixer(mixer), output(output), frames(framesPerBuffer)
+	{
+	}
+
+	~MixerThread() { stop(); }
+
+	bool start()
+	{
+		if (!output.open(mixer.sampleRate(), 2, frames))
+			return false;
+		running.store(true, std::memory_order_release);
+		worker = std::thread(&MixerThread::run, this);
+		return true;
+	}
+
+	void stop()
+	{
+		running.store(false, std::memory_order_release);
+		if (worker.joinable()) {
+			worker.join();
+			output.close();
+		}
+	}
+
+	// readable from any thread
+	unsigned int callbacks() const { return callbackCount.load(std::memory_order_relaxed); }
+	double averageMixUs() const { unsigned int n = callbacks(); return n ? totalNs.load(std::memory_order_relaxed) / 1000.0 / n : 0.0; }
+	double maxMixUs() const { return maxNs.load(std::memory_order_relaxed) / 1000.0; }
+	double budgetUs() const { return frames * 1.0e6 / mixer.sampleRate(); }
+	unsigned int underruns() const { return output.underruns() + (mixer.music ? mixer.music->underruns() : 0); }
+
+private:
+	Mixer& mixer;
+	AudioOutput& output;
+	unsigned int frames;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::atomic<unsigned int> callbackCount{ 0 };
+	std::atomic<unsigned long long> totalNs{ 0 };
+	std::atomic<unsigned long long> maxNs{ 0 };
+
+	void run()
+	{
+		PROFILE_THREAD("mixer");
+		std::vector<float> mixed(frames * 2);
+		std::vector<short> samples(frames * 2);
+		while (running.load(std::memory_order_acquire)) {
+			unsigned long long ns;
+			{
+				PROFILE_SCOPE("audio.mix");
+				ALLOC_SCOPE("audio.mix");
+				std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+				mixer.mix(mixed.data(), frames);
+				toPcm16(mixed.data(), samples.data(), frames * 2);
+				ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+			}
+			totalNs.fetch_add(ns, std::memory_order_relaxed);
+			if (ns > maxNs.load(std::memory_order_relaxed))
+				maxNs.store(ns, std::memory_order_relaxed);
+			callbackCount.fetch_add(1, std::memory_order_relaxed);
+			if (!output.write(samples.data(), frames)) {
+				LOG_ERROR(SOUND, "audio output failed, mixer stopped");
+				return;
+			}
+		}
+	}
+};
+#endif
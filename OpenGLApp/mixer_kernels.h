@@ -0,0 +1,129 @@
+#ifndef MIXER_KERNELS_H
+#define MIXER_KERNELS_H
+
+#include "simd.h"
+
+#include <cmath>
+
+// Adds frames of 16 bit samples (mono or interleaved stereo) to an
+// interleaved stereo float buffer, the left channel scaled by gainL and the
+// right by gainR; a mono sample goes to both. Gains include the 1/32768 that
+// takes a sample to -1..1.
+inline void mixVoiceScalar(float* out, const short* in, unsigned int channels, unsigned int frames, float gainL, float gainR)
+{
+	if (channels == 2) {
+		for (unsigned int i = 0; i < frames; i++) {
+			out[i * 2] += (float)in[i * 2] * gainL;
+			out[i * 2 + 1] += (float)in[i * 2 + 1] * gainR;
+		}
+	}
+	else {
+		for (unsigned int i = 0; i < frames; i++) {
+			out[i * 2] += (float)in[i] * gainL;
+			out[i * 2 + 1] += (float)in[i] * gainR;
+		}
+	}
+}
+
+// -1..1 floats to 16 bit samples, clipped, rounded to nearest
+inline void toPcm16Scalar(const float* in, short* out, unsigned int samples)
+{
+	for (unsigned int i = 0; i < samples; i++) {
+		float v = std::fmax(-1.0f, std::fmin(1.0f, in[i])) * 32767.0f;
+		out[i] = (short)std::lrint(v);
+	}
+}
+
+#ifdef SIMD_SSE2
+inline void mixVoiceSSE(float* out, const short* in, unsigned int channels, unsigned int frames, float gainL, float gainR)
+{
+	__m128 gain = _mm_setr_ps(gainL, gainR, gainL, gainR);
+	unsigned int i = 0;
+	if (channels == 2) {
+		// four frames, eight samples, per step
+		for (; i + 4 <= frames; i += 4) {
+			__m128i s = _mm_loadu_si128((const __m128i*)(in + i * 2));
+			__m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+			__m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+			_mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_loadu_ps(out + i * 2), _mm_mul_ps(lo, gain)));
+			_mm_storeu_ps(out + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + i * 2 + 4), _mm_mul_ps(hi, gain)));
+		}
+		mixVoiceScalar(out + i * 2, in + i * 2, 2, frames - i, gainL, gainR);
+	}
+	else {
+		for (; i + 4 <= frames; i += 4) {
+			__m128i s = _mm_loadl_epi64((const __m128i*)(in + i));
+			__m128 m = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+			// each sample twice, for left and right
+			__m128 lo = _mm_unpacklo_ps(m, m);
+			__m128 hi = _mm_unpackhi_ps(m, m);
+			_mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_loadu_ps(out + i * 2), _mm_mul_ps(lo, gain)));
+			_mm_storeu_ps(out + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + i * 2 + 4), _mm_mul_ps(hi, gain)));
+		}
+		mixVoiceScalar(out + i * 2, in + i, 1, frames - i, gainL, gainR);
+	}
+}
+
+inline void toPcm16SSE(const float* in, short* out, unsigned int samples)
+{
+	__m128 low = _mm_set1_ps(-1.0f), high = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+	unsigned int i = 0;
+	for (; i + 8 <= samples; i += 8) {
+		__m128 a = _mm_mul_ps(_mm_max_ps(low, _mm_min_ps(high, _mm_loadu_ps(in + i))), scale);
+		__m128 b = _mm_mul_ps(_mm_max_ps(low, _mm_min_ps(high, _mm_loadu_ps(in + i + 4))), scale);
+		_mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+	}
+	toPcm16Scalar(in + i, out + i, samples - i);
+}
+#endif
+
+#ifdef SIMD_AVX2
+inline void mixVoiceAVX2(float* out, const short* in, unsigned int channels, unsigned int frames, float gainL, float gainR)
+{
+	__m256 gain = _mm256_setr_ps(gainL, gainR, gainL, gainR, gainL, gainR, gainL, gainR);
+	unsigned int i = 0;
+	if (channels == 2) {
+		for (; i + 8 <= frames; i += 8) {
+			__m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i * 2))));
+			__m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i * 2 + 8))));
+			_mm256_storeu_ps(out + i * 2, _mm256_add_ps(_mm256_loadu_ps(out + i * 2), _mm256_mul_ps(lo, gain)));
+			_mm256_storeu_ps(out + i * 2 + 8, _mm256_add_ps(_mm256_loadu_ps(out + i * 2 + 8), _mm256_mul_ps(hi, gain)));
+		}
+	}
+	else {
+		for (; i + 8 <= frames; i += 8) {
+			__m256 m = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i))));
+			// unpack works per 128 bit lane: (0 0 1 1 | 4 4 5 5) and (2 2 3 3 | 6 6 7 7)
+			__m256 a = _mm256_unpacklo_ps(m, m);
+			__m256 b = _mm256_unpackhi_ps(m, m);
+			__m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+			__m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+			_mm256_storeu_ps(out + i * 2, _mm256_add_ps(_mm256_loadu_ps(out + i * 2), _mm256_mul_ps(lo, gain)));
+			_mm256_storeu_ps(out + i * 2 + 8, _mm256_add_ps(_mm256_loadu_ps(out + i * 2 + 8), _mm256_mul_ps(hi, gain)));
+		}
+	}
+	mixVoiceSSE(out + i * 2, in + i * channels, channels, frames - i, gainL, gainR);
+}
+#endif
+
+// the widest kernels this build was compiled for
+inline void mixVoice(float* out, const short* in, unsigned int channels, unsigned int frames, float gainL, float gainR)
+{
+#if defined(SIMD_AVX2)
+	mixVoiceAVX2(out, in, channels, frames, gainL, gainR);
+#elif defined(SIMD_SSE2)
+	mixVoiceSSE(out, in, channels, frames, gainL, gainR);
+#else
+	mixVoiceScalar(out, in, channels, frames, gainL, gainR);
+#endif
+}
+
+inline void toPcm16(const float* in, short* out, unsigned int samples)
+{
+#if defined(SIMD_SSE2)
+	toPcm16SSE(in, out, samples);
+#else
+	toPcm16Scalar(in, out, samples);
+#endif
+}
+#endif
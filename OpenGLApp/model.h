@@ -0,0 +1,346 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "stb_image.h"
+#include "shader_s.h"
+#include "gl_state.h"
+#include "bounds.h"
+#include "hull.h"
+#include "profiler.h"
+#include "logging.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Struct for Vertex
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 TexCoords;
+};
+
+// Struct for Texture
+struct Texture {
+	unsigned int id;
+	std::string type;
+	std::string path;
+};
+
+// Sub-range of a MeshBuffer holding one mesh
+struct MeshRange {
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	int baseVertex;
+};
+
+// Shared vertex/index storage: many meshes are appended into one VAO/VBO/EBO so
+// they can be drawn without switching vertex state (and with a single multi-draw)
+class MeshBuffer {
+public:
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	unsigned int VAO = 0, VBO = 0, EBO = 0;
+
+	MeshRange add(const std::vector<Vertex>& meshVertices, const std::vector<unsigned int>& meshIndices) {
+		MeshRange range;
+		range.firstIndex = (unsigned int)indices.size();
+		range.indexCount = (unsigned int)meshIndices.size();
+		range.baseVertex = (int)vertices.size();
+		vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+		indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+		return range;
+	}
+
+	// create the GL objects once every mesh has been added; the vertex layout is the same as Mesh's
+	void upload() {
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+
+		glState().bindVertexArray(VAO);
+
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+
+		glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+	}
+};
+
+// Helper function for loading textures
+inline unsigned int TextureFromFile(const char* path, const std::string& directory) {
+	std::string filename = directory + "/" + std::string(path);
+	LOG_INFO(TEXTURE, "Loading texture: %s", filename.c_str());
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	int width, height, nrComponents;
+	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+	if (data) {
+		GLenum format;
+		if (nrComponents == 1)
+			format = GL_RED;
+		else if (nrComponents == 3)
+			format = GL_RGB;
+		else if (nrComponents == 4)
+			format = GL_RGBA;
+
+		glState().bindTexture(0, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		stbi_image_free(data);
+	}
+	else {
+		LOG_ERROR(TEXTURE, "failed to load at path: %s", path);
+		stbi_image_free(data);
+	}
+	return textureID;
+}
+
+// Mesh class
+class Mesh {
+public:
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<Texture> textures;
+	unsigned int VAO;
+	// where the geometry lives when the mesh was appended to a MeshBuffer
+	MeshBuffer* buffer;
+	MeshRange range;
+	// local-space bounds, computed once at load
+	AABB bounds;
+	BoundingSphere sphere;
+	// "material.texture_diffuse1" and so on, one per texture, built once so drawing allocates nothing
+	std::vector<std::string> samplerNames;
+
+	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, MeshBuffer* buffer = nullptr) {
+		this->vertices = vertices;
+		this->indices = indices;
+		this->textures = textures;
+		this->buffer = buffer;
+		computeBounds();
+		nameSamplers();
+		if (buffer)
+			range = buffer->add(vertices, indices);
+		else
+			setupMesh();
+	}
+
+	void Draw(Shader& shader) {
+		for (unsigned int i = 0; i < textures.size(); i++) {
+			shader.setInt(samplerNames[i].c_str(), i);
+			glState().bindTexture(i, textures[i].id);
+		}
+
+		if (buffer) {
+			glState().bindVertexArray(buffer->VAO);
+			glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+				(void*)(range.firstIndex * sizeof(unsigned int)), range.baseVertex);
+			countDraw(range.indexCount / 3);
+			return;
+		}
+		glState().bindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+		countDraw(indices.size() / 3);
+	}
+
+private:
+	unsigned int VBO, EBO;
+
+	void nameSamplers() {
+		unsigned int diffuseNr = 1;
+		unsigned int specularNr = 1;
+		samplerNames.clear();
+		for (unsigned int i = 0; i < textures.size(); i++) {
+			std::string number;
+			std::string name = textures[i].type;
+			if (name == "texture_diffuse")
+				number = std::to_string(diffuseNr++);
+			else if (name == "texture_specular")
+				number = std::to_string(specularNr++);
+			samplerNames.push_back("material." + name + number);
+		}
+	}
+
+	void computeBounds() {
+		bounds = emptyAABB();
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			expand(bounds, vertices[i].Position);
+		if (vertices.empty())
+			bounds = AABB{ glm::vec3(0.0f), glm::vec3(0.0f) };
+		sphere = sphereAround(bounds, vertices.empty() ? nullptr : &vertices[0].Position, (unsigned int)vertices.size(), sizeof(Vertex));
+	}
+
+	void setupMesh() {
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+
+		glState().bindVertexArray(VAO);
+
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+
+		glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+	}
+};
+
+// Model class
+class Model {
+public:
+	std::vector<Mesh> meshes;
+	// local-space bounds of all meshes together
+	AABB bounds;
+	BoundingSphere sphere;
+	// convex hull of all vertices, for collision
+	std::vector<glm::vec3> hull;
+
+	// when a buffer is given the meshes are appended to it instead of getting their own VAO
+	Model(const std::string& path, MeshBuffer* buffer = nullptr) : buffer(buffer) {
+		PROFILE_SCOPE("model.load");
+		loadModel(path);
+		computeBounds();
+	}
+
+	void Draw(Shader& shader) {
+		PROFILE_SCOPE("model.draw");
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			meshes[i].Draw(shader);
+	}
+
+private:
+	MeshBuffer* buffer;
+	std::string directory;
+
+	void loadModel(const std::string& path) {
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			LOG_ERROR(ASSIMP, "%s", importer.GetErrorString());
+			return;
+		}
+		directory = path.substr(0, path.find_last_of('/'));
+		processNode(scene->mRootNode, scene);
+	}
+
+	void computeBounds() {
+		bounds = AABB{ glm::vec3(0.0f), glm::vec3(0.0f) };
+		sphere = BoundingSphere{ glm::vec3(0.0f), 0.0f };
+		if (meshes.empty())
+			return;
+		bounds = emptyAABB();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			expand(bounds, meshes[i].bounds);
+		sphere.center = (bounds.min + bounds.max) * 0.5f;
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			BoundingSphere s = sphereAround(bounds, meshes[i].vertices.empty() ? nullptr : &meshes[i].vertices[0].Position,
+				(unsigned int)meshes[i].vertices.size(), sizeof(Vertex));
+			sphere.radius = std::fmax(sphere.radius, s.radius);
+		}
+		std::vector<glm::vec3> points;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			for (unsigned int v = 0; v < meshes[i].vertices.size(); v++)
+				points.push_back(meshes[i].vertices[v].Position);
+		hull = quickhull(points);
+	}
+
+	void processNode(aiNode* node, const aiScene* scene) {
+		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+			meshes.push_back(processMesh(mesh, scene));
+		}
+		for (unsigned int i = 0; i < node->mNumChildren; i++) {
+			processNode(node->mChildren[i], scene);
+		}
+	}
+
+	Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<Texture> textures;
+
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+			Vertex vertex;
+			glm::vec3 vector;
+			vector.x = mesh->mVertices[i].x;
+			vector.y = mesh->mVertices[i].y;
+			vector.z = mesh->mVertices[i].z;
+			vertex.Position = vector;
+
+			vector.x = mesh->mNormals[i].x;
+			vector.y = mesh->mNormals[i].y;
+			vector.z = mesh->mNormals[i].z;
+			vertex.Normal = vector;
+
+			if (mesh->mTextureCoords[0]) {
+				glm::vec2 vec;
+				vec.x = mesh->mTextureCoords[0][i].x;
+				vec.y = mesh->mTextureCoords[0][i].y;
+				vertex.TexCoords = vec;
+			}
+			else
+				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+
+			vertices.push_back(vertex);
+		}
+
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+			aiFace face = mesh->mFaces[i];
+			for (unsigned int j = 0; j < face.mNumIndices; j++)
+				indices.push_back(face.mIndices[j]);
+		}
+
+		if (mesh->mMaterialIndex >= 0) {
+			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+			std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+			textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+			std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+		}
+
+		return Mesh(vertices, indices, textures, buffer);
+	}
+
+	std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName) {
+		std::vector<Texture> textures;
+		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
+			aiString str;
+			mat->GetTexture(type, i, &str);
+			Texture texture;
+			texture.id = TextureFromFile(str.C_Str(), directory);
+			texture.type = typeName;
+			texture.path = str.C_Str();
+			textures.push_back(texture);
+		}
+		return textures;
+	}
+};
+#endif
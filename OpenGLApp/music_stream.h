@@ -0,0 +1,161 @@
+#ifndef MUSIC_STREAM_H
+#define MUSIC_STREAM_H
+
+#include "sound_bank.h"
+#include "profiler.h"
+#include "logging.h"
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+
+// Lock-free single producer / single consumer ring of samples. Capacity must
+// be a power of two; read and write positions only ever grow.
+template <typename T, unsigned int Capacity>
+class SampleRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SampleRing capacity must be a power of two");
+
+public:
+	SampleRing() : data(Capacity) {}
+
+	// producer side; returns how many fit
+	unsigned int write(const T* values, unsigned int count)
+	{
+		size_t w = writePosition.load(std::memory_order_relaxed);
+		size_t r = readPosition.load(std::memory_order_acquire);
+		count = std::min(count, (unsigned int)(Capacity - (w - r)));
+		for (unsigned int i = 0; i < count; i++)
+			data[(w + i) & (Capacity - 1)] = values[i];
+		writePosition.store(w + count, std::memory_order_release);
+		return count;
+	}
+
+	// consumer side; returns how many were there
+	unsigned int read(T* values, unsigned int count)
+	{
+		size_t r = readPosition.load(std::memory_order_relaxed);
+		size_t w = writePosition.load(std::memory_order_acquire);
+		count = std::min(count, (unsigned int)(w - r));
+		for (unsigned int i = 0; i < count; i++)
+			values[i] = data[(r + i) & (Capacity - 1)];
+		readPosition.store(r + count, std::memory_order_release);
+		return count;
+	}
+
+	unsigned int space() const
+	{
+		return Capacity - (unsigned int)(writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_acquire));
+	}
+
+private:
+	std::vector<T> data;
+	alignas(64) std::atomic<size_t> writePosition{ 0 };
+	alignas(64) std::atomic<size_t> readPosition{ 0 };
+};
+
+// A looping background track streamed from a WAVE file. A decoder thread
+// reads the file in chunks and keeps a ring of about a second and a half of
+// samples topped up; the mixer takes frames out of it without ever touching
+// the disk. A read that finds the ring short is an underrun: the missing
+// frames stay silent.
+class MusicStream
+{
+public:
+	~MusicStream() { stop(); }
+
+	// the track has to be at the mixer's sample rate, mono or stereo
+	bool open(const std::string& path, unsigned int sampleRate)
+	{
+		file.open(path, std::ios::binary);
+		if (!file.is_open()) {
+			LOG_ERROR(SOUND, "could not open %s", path.c_str());
+			return false;
+		}
+		if (!readWavFormat(file, path, format))
+			return false;
+		if (format.sampleRate != sampleRate || format.channels > 2) {
+			LOG_ERROR(SOUND, "%s is not mono or stereo at %u Hz", path.c_str(), sampleRate);
+			return false;
+		}
+		if (format.dataBytes < format.frameBytes()) {
+			LOG_ERROR(SOUND, "%s has no sample data", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void start()
+	{
+		running.store(true, std::memory_order_release);
+		worker = std::thread(&MusicStream::run, this);
+	}
+
+	void stop()
+	{
+		running.store(false, std::memory_order_release);
+		if (worker.joinable())
+			worker.join();
+	}
+
+	unsigned int channels() const { return format.channels; }
+
+	// mixer side: up to frames frames into out; returns how many
+	unsigned int read(short* out, unsigned int frames)
+	{
+		unsigned int got = ring.read(out, frames * format.channels) / format.channels;
+		if (got < frames)
+			underrunCount.fetch_add(1, std::memory_order_relaxed);
+		return got;
+	}
+
+	unsigned int underruns() const { return underrunCount.load(std::memory_order_relaxed); }
+
+private:
+	enum : unsigned int {
+		RING_SAMPLES = 1 << 17,  // 1.5 s of 44.1 kHz stereo
+		CHUNK_FRAMES = 4096,
+	};
+
+	std::ifstream file;
+	WavFormat format;
+	SampleRing<short, RING_SAMPLES> ring;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::atomic<unsigned int> underrunCount{ 0 };
+
+	void run()
+	{
+		PROFILE_THREAD("music decoder");
+		std::vector<unsigned char> bytes(CHUNK_FRAMES * format.frameBytes());
+		std::vector<short> samples(CHUNK_FRAMES * format.channels);
+		unsigned int dataFrames = format.dataBytes / format.frameBytes();
+		unsigned int frame = 0;
+		file.seekg(format.dataOffset);
+		while (running.load(std::memory_order_acquire)) {
+			if (ring.space() < samples.size()) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				continue;
+			}
+			unsigned int frames = std::min((unsigned int)CHUNK_FRAMES, dataFrames - frame);
+			file.read((char*)bytes.data(), frames * format.frameBytes());
+			frames = (unsigned int)(file.gcount() / format.frameBytes());
+			if (frames == 0 && frame == 0)
+				return; // nothing left to play; the mixer gets silence
+			convertPcm(bytes.data(), frames * format.channels, format.bits, samples.data());
+			ring.write(samples.data(), frames * format.channels);
+			frame += frames;
+			// back to the start at the end of the track, or of a truncated file
+			if (frame >= dataFrames || frames == 0) {
+				file.clear();
+				file.seekg(format.dataOffset);
+				frame = 0;
+			}
+		}
+	}
+};
+#endif
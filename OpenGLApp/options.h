@@ -0,0 +1,182 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Command line switches
+struct AppOptions {
+	// --headless: render offscreen through EGL for a fixed number of frames and print timings
+	bool headless = false;
+	int frames = 600;          // --frames N
+	int width = 800;           // --size WxH
+	int height = 600;
+	std::string pngPath;       // --png out.png, dump of the last frame
+	int tickRate = 60;         // --tick-rate HZ, simulation ticks per second
+	int soakMinutes = 0;       // --soak MINUTES, windowless long-session check
+	bool benchSoa = false;     // --bench-soa, AoS vs SoA food step timings
+	bool benchJobs = false;    // --bench-jobs, job system overhead and scaling
+	int benchBatch = 0;        // --bench-batch SESSIONS, BatchSim check and thread scaling
+	bool benchAudio = false;   // --bench-audio, sound bank decoding and voice pool
+	std::string audioLogPath;  // --audio-log FILE, play through the null audio backend and log every voice
+	std::string audioOutPath;  // --audio-out FILE.wav, mix to a WAVE file instead of the sound device
+	std::string musicPath;     // --music FILE.wav, background track streamed from disk
+	std::string tracePath;     // --trace out.json, Chrome trace of the profiled scopes
+	std::string telemetryPath; // --telemetry FILE[.csv], per-frame metrics streamed to disk
+	std::string analyzePath;   // --analyze FILE, percentiles and leak trends of a telemetry recording
+	std::string baselinePath;  // --baseline FILE, recording --analyze checks for regressions against
+	std::string logPath;       // --log FILE, log lines copied to a file as well
+	bool allocReport = false;  // --alloc-report, steady-state allocations per frame by thread, subsystem and call site
+	bool checkTunneling = false; // --check-tunneling, swept collision at extreme speeds
+	bool gjk = false;          // --gjk, confirm plate hits on the model hulls
+	unsigned int seed = 0;     // --seed N, spawn randomness (random when not given)
+	bool hasSeed = false;
+	std::string recordPath;    // --record FILE, plate input of every tick
+	std::string replayPath;    // --replay FILE, play a recording back with its seed and tick rate
+	// --balance LEVELS, windowless play-through with per-level statistics, and its tuning overrides
+	int balanceLevels = 0;
+	std::string controller = "chase"; // --controller still|sweep|chase|planner
+	float delay = 0.0f;        // --delay S, first spawn delay (0 keeps the game's)
+	float foodSpeed = 0.0f;    // --food-speed U, first fall speed per second
+	float levelSeconds = 0.0f; // --level-seconds S, length of a level
+	float speedStep = -1.0f;   // --speed-step U, level curve (negative keeps the game's)
+	float delayStep = -1.0f;   // --delay-step S
+};
+
+// returns false (after printing usage) on an unknown or malformed switch
+inline bool parseOptions(int argc, char** argv, AppOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--headless") {
+			options.headless = true;
+		}
+		else if (arg == "--frames" && hasValue) {
+			options.frames = std::atoi(argv[++i]);
+		}
+		else if (arg == "--size" && hasValue) {
+			const char* value = argv[++i];
+			const char* x = std::strchr(value, 'x');
+			if (!x) {
+				std::cout << "--size expects WxH, got " << value << std::endl;
+				return false;
+			}
+			options.width = std::atoi(value);
+			options.height = std::atoi(x + 1);
+		}
+		else if (arg == "--png" && hasValue) {
+			options.pngPath = argv[++i];
+		}
+		else if (arg == "--tick-rate" && hasValue) {
+			options.tickRate = std::atoi(argv[++i]);
+		}
+		else if (arg == "--soak" && hasValue) {
+			options.soakMinutes = std::atoi(argv[++i]);
+		}
+		else if (arg == "--bench-soa") {
+			options.benchSoa = true;
+		}
+		else if (arg == "--bench-batch" && hasValue) {
+			options.benchBatch = std::atoi(argv[++i]);
+		}
+		else if (arg == "--bench-jobs") {
+			options.benchJobs = true;
+		}
+		else if (arg == "--bench-audio") {
+			options.benchAudio = true;
+		}
+		else if (arg == "--audio-log" && hasValue) {
+			options.audioLogPath = argv[++i];
+		}
+		else if (arg == "--audio-out" && hasValue) {
+			options.audioOutPath = argv[++i];
+		}
+		else if (arg == "--music" && hasValue) {
+			options.musicPath = argv[++i];
+		}
+		else if (arg == "--trace" && hasValue) {
+			options.tracePath = argv[++i];
+		}
+		else if (arg == "--telemetry" && hasValue) {
+			options.telemetryPath = argv[++i];
+		}
+		else if (arg == "--analyze" && hasValue) {
+			options.analyzePath = argv[++i];
+		}
+		else if (arg == "--baseline" && hasValue) {
+			options.baselinePath = argv[++i];
+		}
+		else if (arg == "--log" && hasValue) {
+			options.logPath = argv[++i];
+		}
+		else if (arg == "--alloc-report") {
+			options.allocReport = true;
+		}
+		else if (arg == "--check-tunneling") {
+			options.checkTunneling = true;
+		}
+		else if (arg == "--balance" && hasValue) {
+			options.balanceLevels = std::atoi(argv[++i]);
+		}
+		else if (arg == "--controller" && hasValue) {
+			options.controller = argv[++i];
+			if (options.controller != "still" && options.controller != "sweep" && options.controller != "chase" && options.controller != "planner") {
+				std::cout << "--controller expects still, sweep, chase or planner, got " << options.controller << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--delay" && hasValue) {
+			options.delay = (float)std::atof(argv[++i]);
+		}
+		else if (arg == "--food-speed" && hasValue) {
+			options.foodSpeed = (float)std::atof(argv[++i]);
+		}
+		else if (arg == "--level-seconds" && hasValue) {
+			options.levelSeconds = (float)std::atof(argv[++i]);
+		}
+		else if (arg == "--speed-step" && hasValue) {
+			options.speedStep = (float)std::atof(argv[++i]);
+		}
+		else if (arg == "--delay-step" && hasValue) {
+			options.delayStep = (float)std::atof(argv[++i]);
+		}
+		else if (arg == "--seed" && hasValue) {
+			options.seed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+			options.hasSeed = true;
+		}
+		else if (arg == "--record" && hasValue) {
+			options.recordPath = argv[++i];
+		}
+		else if (arg == "--replay" && hasValue) {
+			options.replayPath = argv[++i];
+		}
+		else if (arg == "--gjk") {
+			options.gjk = true;
+		}
+		else {
+			std::cout << "Unknown option " << arg << "\n"
+				<< "usage: OpenGLApp [--tick-rate HZ] [--seed N] [--record FILE | --replay FILE] [--gjk] [--trace out.json] [--log FILE]\n"
+				<< "                 [--music FILE.wav] [--audio-out FILE.wav | --audio-log FILE] [--telemetry FILE[.csv]] [--alloc-report]\n"
+				<< "                 [--headless [--frames N] [--size WxH] [--png out.png]]\n"
+				<< "       OpenGLApp [--tick-rate HZ] --soak MINUTES\n"
+				<< "       OpenGLApp --bench-soa\n"
+				<< "       OpenGLApp --bench-batch SESSIONS\n"
+				<< "       OpenGLApp --bench-jobs\n"
+				<< "       OpenGLApp --bench-audio\n"
+				<< "       OpenGLApp --check-tunneling\n"
+				<< "       OpenGLApp --analyze FILE [--baseline FILE]\n"
+				<< "       OpenGLApp [--tick-rate HZ] --balance LEVELS [--controller still|sweep|chase|planner] [--delay S]\n"
+				<< "                 [--food-speed U] [--level-seconds S] [--speed-step U] [--delay-step S]" << std::endl;
+			return false;
+		}
+	}
+	if (options.frames <= 0 || options.width <= 0 || options.height <= 0 || options.tickRate <= 0) {
+		std::cout << "Frame count, size and tick rate must be positive" << std::endl;
+		return false;
+	}
+	return true;
+}
+#endif
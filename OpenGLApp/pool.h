@@ -0,0 +1,112 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <vector>
+
+// Handle bookkeeping for densely packed storage. Items live at dense indices
+// 0..size-1 and removal moves the last item into the hole, so a loop over them
+// touches live items only. Every item also gets a handle that stays valid
+// while it lives; handles of removed items go on a free list and are handed
+// out again, so nothing ever grows past the capacity given at construction.
+// The storage itself belongs to the caller, which lets it be one array (Pool)
+// or one array per field.
+class HandleTable
+{
+public:
+	enum : unsigned int { INVALID = 0xFFFFFFFFu };
+
+	explicit HandleTable(unsigned int capacity)
+	{
+		denseToHandle.reserve(capacity);
+		handleToDense.resize(capacity, INVALID);
+		freeHandles.reserve(capacity);
+		for (unsigned int h = capacity; h > 0; h--)
+			freeHandles.push_back(h - 1);
+	}
+
+	unsigned int size() const { return (unsigned int)denseToHandle.size(); }
+	unsigned int capacity() const { return (unsigned int)handleToDense.size(); }
+	bool full() const { return freeHandles.empty(); }
+
+	// handle for a new item appended at dense index size(), or INVALID when full
+	unsigned int add()
+	{
+		if (freeHandles.empty())
+			return INVALID;
+		unsigned int handle = freeHandles.back();
+		freeHandles.pop_back();
+		handleToDense[handle] = (unsigned int)denseToHandle.size();
+		denseToHandle.push_back(handle);
+		return handle;
+	}
+
+	// forgets the item at dense index i; the caller moves its last item to i
+	void remove(unsigned int i)
+	{
+		unsigned int last = (unsigned int)denseToHandle.size() - 1;
+		unsigned int handle = denseToHandle[i];
+		if (i != last) {
+			denseToHandle[i] = denseToHandle[last];
+			handleToDense[denseToHandle[i]] = i;
+		}
+		denseToHandle.pop_back();
+		handleToDense[handle] = INVALID;
+		freeHandles.push_back(handle);
+	}
+
+	unsigned int handle(unsigned int i) const { return denseToHandle[i]; }
+	// dense index of a live handle, INVALID once the item was removed
+	unsigned int index(unsigned int handle) const { return handleToDense[handle]; }
+
+private:
+	std::vector<unsigned int> denseToHandle;
+	std::vector<unsigned int> handleToDense;
+	std::vector<unsigned int> freeHandles;
+};
+
+// Fixed-capacity object pool: one array of T, packed and addressed through a HandleTable
+template <typename T>
+class Pool
+{
+public:
+	enum : unsigned int { INVALID = HandleTable::INVALID };
+
+	explicit Pool(unsigned int capacity) : handles(capacity)
+	{
+		items.reserve(capacity);
+	}
+
+	unsigned int size() const { return (unsigned int)items.size(); }
+	unsigned int capacity() const { return handles.capacity(); }
+	bool full() const { return handles.full(); }
+
+	T& operator[](unsigned int i) { return items[i]; }
+	const T& operator[](unsigned int i) const { return items[i]; }
+	const T* begin() const { return items.data(); }
+	const T* end() const { return items.data() + items.size(); }
+
+	// returns the new item's handle, or INVALID when the pool is full
+	unsigned int add(const T& item)
+	{
+		unsigned int handle = handles.add();
+		if (handle != INVALID)
+			items.push_back(item);
+		return handle;
+	}
+
+	// removes the item at dense index i; the last item moves into its place
+	void remove(unsigned int i)
+	{
+		handles.remove(i);
+		items[i] = items.back();
+		items.pop_back();
+	}
+
+	unsigned int handle(unsigned int i) const { return handles.handle(i); }
+	unsigned int index(unsigned int handle) const { return handles.index(handle); }
+
+private:
+	HandleTable handles;
+	std::vector<T> items;
+};
+#endif
@@ -0,0 +1,223 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped CPU profiling. PROFILE_SCOPE("foods.update") times the rest of the
+// enclosing block on the calling thread; the name must be a string literal.
+// Build with PROFILER_ENABLED 0 and every macro compiles to nothing (but the
+// thread name, which the allocation report keeps using); built in
+// but not started, a scope costs one relaxed load and a branch.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+#include "logging.h"
+#include "alloc_tracker.h"
+
+// Keeps finished scopes per thread: every thread appends to a buffer of its
+// own without locking, and only registering a thread's buffer (once, at its
+// first scope) takes the mutex. Buffers outlive their threads, so a trace
+// written at exit still has the job workers and the sim thread.
+class Profiler {
+public:
+	struct Event {
+		const char* name;
+		long long begin; // ns since start()
+		long long duration;
+	};
+
+	void start()
+	{
+		epoch = std::chrono::steady_clock::now();
+		enabled.store(true, std::memory_order_release);
+	}
+	void stop() { enabled.store(false, std::memory_order_release); }
+	bool running() const { return enabled.load(std::memory_order_relaxed); }
+
+	long long now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	void record(const char* name, long long begin, long long end)
+	{
+		ThreadBuffer& buffer = threadBuffer();
+		unsigned int count = buffer.count.load(std::memory_order_relaxed);
+		if (count == CAPACITY) {
+			buffer.dropped++;
+			return;
+		}
+		buffer.events[count] = Event{ name, begin, end - begin };
+		buffer.count.store(count + 1, std::memory_order_release);
+	}
+
+	// labels the calling thread in the trace; threads that never record cost nothing
+	void nameThread(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		localName() = name;
+		if (localBuffer())
+			localBuffer()->name = name;
+		allocThreadName(name);
+	}
+
+	// Chrome Trace Event format, for chrome://tracing or ui.perfetto.dev
+	bool writeChromeTrace(const std::string& path)
+	{
+		std::ofstream file(path);
+		if (!file) {
+			LOG_ERROR(PROFILER, "could not write %s", path.c_str());
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		size_t events = 0, dropped = 0;
+		for (unsigned int t = 0; t < buffers.size(); t++) {
+			const ThreadBuffer& buffer = *buffers[t];
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+				<< ",\"args\":{\"name\":\"" << escape(buffer.name) << "\"}}";
+			first = false;
+			unsigned int count = buffer.count.load(std::memory_order_acquire);
+			for (unsigned int i = 0; i < count; i++) {
+				const Event& e = buffer.events[i];
+				file << ",\n{\"name\":\"" << escape(e.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+					<< ",\"ts\":" << e.begin / 1000.0 << ",\"dur\":" << e.duration / 1000.0 << "}";
+			}
+			events += count;
+			dropped += buffer.dropped;
+		}
+		file << "\n]}\n";
+		std::cout << "Trace of " << events << " scopes on " << buffers.size() << " threads written to " << path;
+		if (dropped)
+			std::cout << " (" << dropped << " dropped, buffers full)";
+		std::cout << std::endl;
+		return true;
+	}
+
+private:
+	enum : unsigned int { CAPACITY = 1 << 18 }; // scopes per thread, 6 MB
+
+	struct ThreadBuffer {
+		std::string name;
+		std::vector<Event> events;
+		std::atomic<unsigned int> count{ 0 };
+		unsigned long long dropped = 0;
+	};
+
+	std::atomic<bool> enabled{ false };
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer> > buffers;
+
+	static ThreadBuffer*& localBuffer()
+	{
+		static thread_local ThreadBuffer* buffer = nullptr;
+		return buffer;
+	}
+	static std::string& localName()
+	{
+		static thread_local std::string name;
+		return name;
+	}
+
+	ThreadBuffer& threadBuffer()
+	{
+		ThreadBuffer*& buffer = localBuffer();
+		if (!buffer) {
+			std::unique_ptr<ThreadBuffer> created(new ThreadBuffer());
+			created->events.resize(CAPACITY);
+			std::lock_guard<std::mutex> lock(mutex);
+			created->name = !localName().empty() ? localName() : "thread " + std::to_string(buffers.size());
+			buffer = created.get();
+			buffers.push_back(std::move(created));
+		}
+		return *buffer;
+	}
+
+	static std::string escape(const std::string& text)
+	{
+		std::string out;
+		for (size_t i = 0; i < text.size(); i++) {
+			if (text[i] == '"' || text[i] == '\\')
+				out += '\\';
+			out += text[i];
+		}
+		return out;
+	}
+};
+
+inline Profiler& profiler()
+{
+	static Profiler instance;
+	return instance;
+}
+
+// Times its own lifetime
+class ProfileScope {
+public:
+	explicit ProfileScope(const char* name) : name(name), begin(profiler().running() ? profiler().now() : -1) {}
+	~ProfileScope()
+	{
+		if (begin >= 0)
+			profiler().record(name, begin, profiler().now());
+	}
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* name;
+	long long begin;
+};
+
+// Back-to-back stages of straight-line code, such as startup: next() ends the
+// current stage and begins the named one, end() ends the last.
+class ProfileStages {
+public:
+	~ProfileStages() { end(); }
+	void next(const char* stage)
+	{
+		end();
+		if (profiler().running()) {
+			name = stage;
+			begin = profiler().now();
+		}
+	}
+	void end()
+	{
+		if (name)
+			profiler().record(name, begin, profiler().now());
+		name = nullptr;
+	}
+
+private:
+	const char* name = nullptr;
+	long long begin = 0;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#if PROFILER_ENABLED
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_STAGES(var) ProfileStages var
+#define PROFILE_STAGE(var, name) var.next(name)
+#define PROFILE_STAGES_END(var) var.end()
+#define PROFILE_THREAD(name) profiler().nameThread(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_STAGES(var)
+#define PROFILE_STAGE(var, name)
+#define PROFILE_STAGES_END(var)
+#define PROFILE_THREAD(name) allocThreadName(name)
+#endif
+#endif
@@ -0,0 +1,15 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec2 aTexCoords;
+layout(location = 3) in mat4 aModel; // per-instance, filled by FoodBatch
+
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+    TexCoords = aTexCoords; // Pass texture coordinates to fragment shader
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include "game.h"
+#include "triple_buffer.h"
+#include "input_recording.h"
+#include "audio.h"
+#include "profiler.h"
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// Runs the Game on its own thread and hands finished ticks to the render
+// thread as GameSnapshots through a TripleBuffer, so simulating the next tick
+// and submitting GL for the current one overlap and neither side waits when
+// the other spikes. Input travels the other way through an atomic.
+//
+// Realtime mode ticks against the steady clock. Lockstep mode (headless
+// benchmarks) only simulates the time the render thread asks for, which keeps
+// runs repeatable while still overlapping frame N+1's ticks with frame N's draw.
+// A recording, when set, gets the input of every tick; a replay replaces it.
+class SimThread
+{
+public:
+	// the sim thread owns these while running; touch them only before start() or after stop()
+	Game game;
+	InputRecording* recording = nullptr;
+	const InputRecording* replay = nullptr;
+	// gets a sound event for every food collected and every time the plate hits the border
+	AudioThread* audio = nullptr;
+
+	explicit SimThread(unsigned int seed = std::random_device()()) : game(seed) {}
+
+	void start(double tickSeconds, bool lockstepMode)
+	{
+		tickDt = tickSeconds;
+		lockstep = lockstepMode;
+		// the renderer has something to draw before the first tick
+		snapshots.back().capture(game, (float)tickDt);
+		snapshots.back().tickTime = std::chrono::steady_clock::now();
+		snapshots.publish();
+		running.store(true, std::memory_order_release);
+		worker = std::thread(&SimThread::run, this);
+	}
+
+	void stop()
+	{
+		running.store(false, std::memory_order_release);
+		if (worker.joinable())
+			worker.join();
+	}
+
+	// realtime: picked up by the next tick
+	void setInput(const GameInput& input)
+	{
+		plateDirection.store(input.plateDirection, std::memory_order_relaxed);
+	}
+
+	// realtime: newest finished tick
+	const GameSnapshot& latest()
+	{
+		return snapshots.consume();
+	}
+
+	// lockstep: simulate frameSeconds more with this input; returns at once
+	void request(double frameSeconds, const GameInput& input)
+	{
+		requestedDt = frameSeconds;
+		plateDirection.store(input.plateDirection, std::memory_order_relaxed);
+		requested.fetch_add(1, std::memory_order_release);
+	}
+
+	// lockstep: blocks until the last request() is simulated and returns its snapshot
+	const GameSnapshot& wait()
+	{
+		while (completed.load(std::memory_order_acquire) != requested.load(std::memory_order_relaxed))
+			std::this_thread::yield();
+		return snapshots.consume();
+	}
+
+private:
+	TripleBuffer<GameSnapshot> snapshots;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::atomic<int> plateDirection{ 0 };
+	std::atomic<unsigned int> requested{ 0 };
+	std::atomic<unsigned int> completed{ 0 };
+	double requestedDt = 0.0;
+	double tickDt = 1.0 / 60.0;
+	bool lockstep = false;
+	float tickMs = 0.0f; // since the last published snapshot
+
+	void tick(GameInput input)
+	{
+		PROFILE_SCOPE("sim.tick");
+		ALLOC_SCOPE("sim.tick");
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (replay)
+			input.plateDirection = replay->direction(game.ticks);
+		if (recording)
+			recording->record(input.plateDirection);
+		game.tick((float)tickDt, input);
+		if (audio) {
+			for (unsigned int i = 0; i < game.events.size(); i++) {
+				if (game.events[i].type == GameEvent::COLLECTED)
+					audio->post(SoundEvent{ SOUND_PICKUP, 1.0f, game.events[i].position });
+				else if (game.events[i].type == GameEvent::WALL_HIT)
+					audio->post(SoundEvent{ SOUND_WALL, 0.6f, game.events[i].position });
+			}
+		}
+		tickMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void run()
+	{
+		PROFILE_THREAD("sim");
+		typedef std::chrono::steady_clock Clock;
+		Clock::duration tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickDt));
+		Clock::time_point nextTick = Clock::now() + tickDuration;
+		double accumulator = 0.0;
+
+		while (running.load(std::memory_order_acquire)) {
+			GameInput input;
+			if (lockstep) {
+				unsigned int want = requested.load(std::memory_order_acquire);
+				if (want == completed.load(std::memory_order_relaxed)) {
+					std::this_thread::yield();
+					continue;
+				}
+				input.plateDirection = plateDirection.load(std::memory_order_relaxed);
+				accumulator += requestedDt;
+				while (accumulator >= tickDt) {
+					tick(input);
+					accumulator -= tickDt;
+				}
+				GameSnapshot& snapshot = snapshots.back();
+				snapshot.capture(game, (float)tickDt);
+				snapshot.alpha = (float)(accumulator / tickDt);
+				snapshot.simMs = tickMs;
+				tickMs = 0.0f;
+				snapshots.publish();
+				completed.store(want, std::memory_order_release);
+				continue;
+			}
+
+			Clock::time_point now = Clock::now();
+			if (now < nextTick) {
+				// sleep is coarse on some platforms, so the last millisecond is spent yielding
+				if (nextTick - now > std::chrono::milliseconds(2))
+					std::this_thread::sleep_for(nextTick - now - std::chrono::milliseconds(1));
+				else
+					std::this_thread::yield();
+				continue;
+			}
+			// a long stall (breakpoint, suspended process) is not caught up tick by tick
+			if (now - nextTick > std::chrono::milliseconds(250))
+				nextTick = now;
+
+			input.plateDirection = plateDirection.load(std::memory_order_relaxed);
+			tick(input);
+			GameSnapshot& snapshot = snapshots.back();
+			snapshot.capture(game, (float)tickDt);
+			snapshot.tickTime = nextTick;
+			snapshot.simMs = tickMs;
+			tickMs = 0.0f;
+			snapshots.publish();
+			nextTick += tickDuration;
+		}
+	}
+};
+#endif
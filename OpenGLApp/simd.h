@@ -0,0 +1,15 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// The vector instruction sets this build may use. Kernels with SIMD versions
+// test SIMD_SSE2 / SIMD_AVX2 and always keep a scalar version next to them.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+// MSVC defines __AVX2__ under /arch:AVX2
+#if defined(__AVX2__)
+#define SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
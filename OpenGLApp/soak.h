@@ -0,0 +1,83 @@
+#ifndef SOAK_H
+#define SOAK_H
+
+#include "game.h"
+#include "controllers.h"
+#include "telemetry.h"
+#include "alloc_tracker.h"
+
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+// --soak MINUTES: plays that much simulated time without a window and checks
+// that a long session costs the same as a short one. The food storage must
+// never be reallocated, the live foods must stay under the pool capacity, the
+// heap bytes the tracker sees held and the resident set must not grow from the
+// end of the first minute to the end of the last, and the time per live food
+// per tick must not creep up. Returns the exit code.
+inline int runSoak(int minutes, int tickRate)
+{
+	Game game;
+	GameInput input;
+	const float dt = 1.0f / tickRate;
+	const float* storage = game.foods.y.data();
+	unsigned int maxLive = 0;
+	double firstCost = 0.0, lastCost = 0.0;
+	long long firstHeap = 0, lastHeap = 0;
+	unsigned long long firstRss = 0, lastRss = 0;
+
+	for (int minute = 0; minute < minutes; minute++) {
+		unsigned long long foodTicks = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int t = 0; t < tickRate * 60; t++) {
+			chaseInput(game, input);
+			game.tick(dt, input);
+			foodTicks += game.foods.size();
+			maxLive = std::max(maxLive, game.foods.size());
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		double cost = ns / std::max(foodTicks, 1ULL);
+		// the first minute is warm-up
+		if (minute == 1)
+			firstCost = cost;
+		lastCost = cost;
+		lastHeap = liveHeapBytes();
+		lastRss = residentBytes();
+		if (minute == 0) {
+			firstHeap = lastHeap;
+			firstRss = lastRss;
+		}
+		std::cout << "minute " << minute + 1 << ": " << ns / (tickRate * 60) << " ns/tick, " << cost << " ns/food/tick, "
+			<< game.foods.size() << " live, " << game.pairs.size() << " broadphase pairs (" << game.droppedPairs << " dropped), level " << game.level << ", collected " << game.numberOfCollisions
+			<< " of " << game.numberOfObject << ", heap " << lastHeap / 1024 << " KiB, rss " << lastRss / 1024 << " KiB" << std::endl;
+	}
+
+	bool ok = true;
+	if (game.foods.y.data() != storage) {
+		std::cout << "ERROR::SOAK: food storage was reallocated" << std::endl;
+		ok = false;
+	}
+	// a little slack for the allocator's own bookkeeping; a leak of one
+	// allocation per tick is far past it within a minute
+	if (lastHeap > firstHeap + 64 * 1024) {
+		std::cout << "ERROR::SOAK: live heap grew from " << firstHeap / 1024 << " to " << lastHeap / 1024 << " KiB" << std::endl;
+		ok = false;
+	}
+	if (firstRss && lastRss > firstRss + firstRss / 8 + 4 * 1024 * 1024) {
+		std::cout << "ERROR::SOAK: resident set grew from " << firstRss / 1024 << " to " << lastRss / 1024 << " KiB" << std::endl;
+		ok = false;
+	}
+	if (maxLive >= game.foods.capacity()) {
+		std::cout << "ERROR::SOAK: food pool ran full (" << maxLive << " live)" << std::endl;
+		ok = false;
+	}
+	// generous, timings on shared machines are noisy
+	if (minutes > 2 && lastCost > firstCost * 3.0) {
+		std::cout << "ERROR::SOAK: cost per food grew from " << firstCost << " to " << lastCost << " ns" << std::endl;
+		ok = false;
+	}
+	std::cout << (ok ? "Soak passed" : "Soak FAILED") << ": " << minutes << " simulated minutes, at most " << maxLive << " live foods" << std::endl;
+	return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,151 @@
+#ifndef SOUND_BANK_H
+#define SOUND_BANK_H
+
+#include "audio.h"
+#include "logging.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+// A sound decoded into memory: interleaved signed 16 bit samples
+struct SoundClip {
+	unsigned int channels = 0;
+	unsigned int sampleRate = 0;
+	std::vector<short> samples;
+
+	unsigned int frames() const { return channels ? (unsigned int)(samples.size() / channels) : 0; }
+	float seconds() const { return sampleRate ? (float)frames() / sampleRate : 0.0f; }
+};
+
+// Where the samples of a RIFF/WAVE file are and what they look like
+struct WavFormat {
+	unsigned int channels = 0;
+	unsigned int sampleRate = 0;
+	unsigned int bits = 0;
+	std::streamoff dataOffset = 0;
+	unsigned int dataBytes = 0;
+
+	unsigned int frameBytes() const { return channels * bits / 8; }
+};
+
+// Walks the chunks of a RIFF/WAVE stream up to "data" and leaves the stream
+// there. Only 8 and 16 bit PCM is accepted.
+inline bool readWavFormat(std::istream& in, const std::string& name, WavFormat& format)
+{
+	struct Reader {
+		static unsigned int get(const unsigned char* bytes, int size) {
+			unsigned int value = 0;
+			for (int i = 0; i < size; i++)
+				value |= (unsigned int)bytes[i] << (8 * i);
+			return value;
+		}
+	};
+	unsigned char header[16];
+	if (!in.read((char*)header, 12) || std::string((char*)header, 4) != "RIFF" || std::string((char*)header + 8, 4) != "WAVE") {
+		LOG_ERROR(SOUND, "%s is not a WAVE file", name.c_str());
+		return false;
+	}
+	unsigned int encoding = 0;
+	format = WavFormat();
+	while (in.read((char*)header, 8)) {
+		std::string id((char*)header, 4);
+		unsigned int size = Reader::get(header + 4, 4);
+		if (id == "data") {
+			if (encoding != 1 || (format.bits != 8 && format.bits != 16) || format.channels == 0) {
+				LOG_ERROR(SOUND, "%s is not 8 or 16 bit PCM", name.c_str());
+				return false;
+			}
+			format.dataOffset = in.tellg();
+			format.dataBytes = size;
+			return true;
+		}
+		std::streamoff next = (std::streamoff)in.tellg() + size + (size & 1); // chunks are padded to an even size
+		if (id == "fmt " && size >= 16 && in.read((char*)header, 16)) {
+			encoding = Reader::get(header, 2);
+			format.channels = Reader::get(header + 2, 2);
+			format.sampleRate = Reader::get(header + 4, 4);
+			format.bits = Reader::get(header + 14, 2);
+		}
+		in.seekg(next);
+	}
+	LOG_ERROR(SOUND, "%s has no sample data", name.c_str());
+	return false;
+}
+
+// Raw PCM bytes to signed 16 bit samples; 8 bit PCM is unsigned
+inline void convertPcm(const unsigned char* bytes, size_t samples, unsigned int bits, short* out)
+{
+	if (bits == 16) {
+		for (size_t i = 0; i < samples; i++)
+			out[i] = (short)(bytes[i * 2] | (bytes[i * 2 + 1] << 8));
+	}
+	else {
+		for (size_t i = 0; i < samples; i++)
+			out[i] = (short)((bytes[i] - 128) << 8);
+	}
+}
+
+// Reads a RIFF/WAVE file with 8 or 16 bit PCM data into clip
+inline bool decodeWav(const std::string& path, SoundClip& clip)
+{
+	std::ifstream file(path, std::ios::binary);
+	WavFormat format;
+	if (!file.is_open()) {
+		LOG_ERROR(SOUND, "could not open %s", path.c_str());
+		return false;
+	}
+	if (!readWavFormat(file, path, format))
+		return false;
+	std::vector<unsigned char> bytes(format.dataBytes);
+	file.read((char*)bytes.data(), bytes.size());
+	// a truncated file keeps what is there, minus a partial last frame
+	size_t frames = (size_t)file.gcount() / format.frameBytes();
+	clip.channels = format.channels;
+	clip.sampleRate = format.sampleRate;
+	clip.samples.resize(frames * format.channels);
+	convertPcm(bytes.data(), clip.samples.size(), format.bits, clip.samples.data());
+	return true;
+}
+
+// Every sound of the game, decoded once at startup so nothing is looked up by
+// file name or read from disk while playing. Higher priority sounds may take
+// a voice from lower priority ones when all voices are busy, see VoicePool.
+class SoundBank {
+public:
+	bool load(unsigned short id, const std::string& path, int priority)
+	{
+		if (id >= SOUND_COUNT)
+			return false;
+		priorities[id] = priority;
+		return decodeWav(path, clips[id]);
+	}
+
+	// an empty clip when the sound failed to load
+	const SoundClip& clip(unsigned short id) const { return clips[id]; }
+	bool loaded(unsigned short id) const { return id < SOUND_COUNT && clips[id].frames() > 0; }
+	int priority(unsigned short id) const { return priorities[id]; }
+
+	size_t bytes() const
+	{
+		size_t total = 0;
+		for (int i = 0; i < SOUND_COUNT; i++)
+			total += clips[i].samples.size() * sizeof(short);
+		return total;
+	}
+
+private:
+	SoundClip clips[SOUND_COUNT];
+	int priorities[SOUND_COUNT] = {};
+};
+
+// The game's sounds; a pickup matters more than the plate knocking on the border
+inline bool loadGameSounds(SoundBank& bank)
+{
+	bool pickup = bank.load(SOUND_PICKUP, "pickup_sound.wav", 1);
+	bool wall = bank.load(SOUND_WALL, "hitting_wall.wav", 0);
+	return pickup && wall;
+}
+#endif
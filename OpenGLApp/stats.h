@@ -0,0 +1,171 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+// p-th percentile (0..100) of the samples, nearest-rank; the input is left untouched
+inline double percentile(std::vector<double> samples, double p)
+{
+	if (samples.empty())
+		return 0.0;
+	std::sort(samples.begin(), samples.end());
+	size_t rank = (size_t)(p / 100.0 * (samples.size() - 1) + 0.5);
+	return samples[std::min(rank, samples.size() - 1)];
+}
+
+// What the subsystems publish. Counters start from zero every frame; gauges
+// (live foods and the allocation figures) hold whatever was set last.
+enum Stat : unsigned int {
+	STAT_DRAW_CALLS,
+	STAT_TRIANGLES,
+	STAT_TEXTURE_BINDS,
+	STAT_LIVE_FOODS,
+	STAT_ALLOCATIONS,        // every thread's, over the last frame
+	STAT_ALLOCATED_BYTES,
+	STAT_RENDER_ALLOCATIONS, // the render thread's own
+	STAT_FRAME_ARENA_BYTES,  // scratch memory the frame used
+	STAT_COUNT
+};
+
+// Central registry behind the F3 overlay. Publishing is one relaxed atomic
+// add, from any thread; endFrame() on the render thread closes the frame's
+// counters and records its CPU time, so the overlay always shows the last
+// complete frame. Frame times are kept for the graph and the percentiles.
+class StatsRegistry
+{
+public:
+	static const unsigned int HISTORY = 1024; // frames of CPU and GPU times kept
+
+	struct Summary {
+		double fps = 0.0;
+		double cpuP50 = 0.0, cpuP95 = 0.0, cpuP99 = 0.0;
+		double gpuP50 = 0.0, gpuP95 = 0.0, gpuP99 = 0.0;
+	};
+
+	// percentiles and frame rate cover this many seconds
+	double windowSeconds = 5.0;
+
+	StatsRegistry()
+	{
+		for (unsigned int i = 0; i < STAT_COUNT; i++) {
+			counters[i].store(0, std::memory_order_relaxed);
+			frameValues[i] = 0;
+		}
+		scratch.reserve(HISTORY);
+	}
+
+	void add(Stat stat, unsigned long long n = 1) { counters[stat].fetch_add(n, std::memory_order_relaxed); }
+	void set(Stat stat, unsigned long long value) { counters[stat].store(value, std::memory_order_relaxed); }
+
+	// value over the last complete frame
+	unsigned long long frameValue(Stat stat) const { return frameValues[stat]; }
+
+	void endFrame(double cpuMs)
+	{
+		for (unsigned int i = 0; i < STAT_COUNT; i++)
+			frameValues[i] = gauge((Stat)i) ? counters[i].load(std::memory_order_relaxed) : counters[i].exchange(0, std::memory_order_relaxed);
+		cpu.push(cpuMs, seconds());
+	}
+
+	// GPU time of a frame, whenever its query results come back
+	void gpuFrame(double ms) { gpu.push(ms, seconds()); }
+
+	// recomputed at most four times a second, so reading it every frame is cheap
+	const Summary& summary()
+	{
+		double now = seconds();
+		if (now - summaryTime < 0.25)
+			return last;
+		summaryTime = now;
+		unsigned int frames = cpu.window(now - windowSeconds, scratch);
+		last.fps = frames > 1 ? (frames - 1) / (cpu.newestTime() - cpu.timeAt(frames - 1)) : 0.0;
+		percentiles(last.cpuP50, last.cpuP95, last.cpuP99);
+		gpu.window(now - windowSeconds, scratch);
+		percentiles(last.gpuP50, last.gpuP95, last.gpuP99);
+		return last;
+	}
+
+	// the newest count frame times, oldest first; returns how many there were
+	unsigned int cpuHistory(float* out, unsigned int count) const { return cpu.copy(out, count); }
+	unsigned int gpuHistory(float* out, unsigned int count) const { return gpu.copy(out, count); }
+	float newestGpuMs() const { return gpu.size() ? gpu.ms[(gpu.pushed - 1) % HISTORY] : 0.0f; }
+
+private:
+	// ring of (time, ms) samples
+	struct History {
+		float ms[HISTORY];
+		double times[HISTORY];
+		unsigned long long pushed = 0;
+
+		void push(double value, double time)
+		{
+			ms[pushed % HISTORY] = (float)value;
+			times[pushed % HISTORY] = time;
+			pushed++;
+		}
+		unsigned int size() const { return (unsigned int)std::min<unsigned long long>(pushed, HISTORY); }
+		// age 0 is the newest sample
+		double timeAt(unsigned int age) const { return times[(pushed - 1 - age) % HISTORY]; }
+		double newestTime() const { return timeAt(0); }
+
+		// samples newer than since into out; returns how many
+		unsigned int window(double since, std::vector<double>& out) const
+		{
+			out.clear();
+			for (unsigned int age = 0; age < size() && timeAt(age) >= since; age++)
+				out.push_back(ms[(pushed - 1 - age) % HISTORY]);
+			return (unsigned int)out.size();
+		}
+
+		unsigned int copy(float* out, unsigned int count) const
+		{
+			count = std::min(count, size());
+			for (unsigned int i = 0; i < count; i++)
+				out[i] = ms[(pushed - count + i) % HISTORY];
+			return count;
+		}
+	};
+
+	std::atomic<unsigned long long> counters[STAT_COUNT];
+	unsigned long long frameValues[STAT_COUNT];
+	History cpu, gpu;
+	std::vector<double> scratch;
+	Summary last;
+	double summaryTime = -1.0;
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	static bool gauge(Stat stat) { return stat >= STAT_LIVE_FOODS; }
+
+	double seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count(); }
+
+	// over the samples in scratch; sorts them in place instead of copying
+	void percentiles(double& p50, double& p95, double& p99)
+	{
+		if (scratch.empty()) {
+			p50 = p95 = p99 = 0.0;
+			return;
+		}
+		std::sort(scratch.begin(), scratch.end());
+		size_t top = scratch.size() - 1;
+		p50 = scratch[(size_t)(0.50 * top + 0.5)];
+		p95 = scratch[(size_t)(0.95 * top + 0.5)];
+		p99 = scratch[(size_t)(0.99 * top + 0.5)];
+	}
+};
+
+inline StatsRegistry& statsRegistry()
+{
+	static StatsRegistry instance;
+	return instance;
+}
+
+// one draw call of triangles (times instances)
+inline void countDraw(unsigned long long triangles)
+{
+	statsRegistry().add(STAT_DRAW_CALLS);
+	statsRegistry().add(STAT_TRIANGLES, triangles);
+}
+#endif
@@ -0,0 +1,246 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "event_ring.h"
+#include "profiler.h"
+#include "logging.h"
+#include "byte_order.h"
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iterator>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef NOGDI
+#define NOGDI
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// One rendered frame, as the render thread saw it
+struct FrameRecord {
+	unsigned int frame = 0;
+	float seconds = 0.0f;         // since the recording started
+	float frameMs = 0.0f;         // CPU time of the frame, up to the swap
+	float simMs = 0.0f;           // ticks simulated for the snapshot it drew
+	float gpuMs = 0.0f;           // newest GPU frame time known; results lag a few frames
+	unsigned int liveFoods = 0;
+	unsigned int drawCalls = 0;
+	unsigned int allocations = 0;
+	unsigned long long rssBytes = 0; // stamped by the writer thread
+};
+
+// resident set size of this process, 0 where unknown
+inline unsigned long long residentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#elif defined(__linux__)
+	// second field of statm: resident pages; read without a stream, which would allocate
+	char text[128] = {};
+	int fd = open("/proc/self/statm", O_RDONLY);
+	if (fd < 0)
+		return 0;
+	ssize_t got = read(fd, text, sizeof(text) - 1);
+	::close(fd);
+	unsigned long long size = 0, resident = 0;
+	if (got <= 0 || std::sscanf(text, "%llu %llu", &size, &resident) != 2)
+		return 0;
+	return resident * (unsigned long long)sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+// Streams FrameRecords to disk from a thread of its own, for sessions that
+// run for hours. The render thread only pushes into a bounded ring; a full
+// ring drops the record and counts it instead of stalling the frame. The
+// writer wakes every 50 ms, stamps what it drained with the current RSS and
+// appends it. A path ending in .csv gets text, anything else the compact
+// binary form:
+//
+//   "FRTM", version, record size (u32), then per frame: frame (u32), seconds,
+//   frame ms, sim ms, gpu ms (f32), foods, draws, allocations (u32), rss (u64)
+//
+// all little endian.
+class TelemetryWriter
+{
+public:
+	~TelemetryWriter() { close(); }
+
+	bool open(const std::string& path)
+	{
+		csv = path.size() > 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+		file.open(path, csv ? std::ios::out : std::ios::binary);
+		if (!file) {
+			LOG_ERROR(TELEMETRY, "could not write %s", path.c_str());
+			return false;
+		}
+		if (csv) {
+			file << "frame,seconds,frame_ms,sim_ms,gpu_ms,foods,draws,allocations,rss_kb\n";
+		}
+		else {
+			std::vector<unsigned char> header;
+			header.push_back('F'); header.push_back('R'); header.push_back('T'); header.push_back('M');
+			putLE(header, VERSION, 4);
+			putLE(header, RECORD_BYTES, 4);
+			file.write((const char*)header.data(), header.size());
+		}
+		running.store(true, std::memory_order_release);
+		worker = std::thread(&TelemetryWriter::run, this);
+		return true;
+	}
+
+	void close()
+	{
+		running.store(false, std::memory_order_release);
+		if (worker.joinable())
+			worker.join();
+		if (file.is_open())
+			file.close();
+	}
+
+	bool recording() const { return running.load(std::memory_order_relaxed); }
+
+	// render thread; never blocks
+	void push(const FrameRecord& record) { ring.push(record); }
+
+	unsigned long long written() const { return writtenCount.load(std::memory_order_relaxed); }
+	unsigned int dropped() const { return ring.droppedCount(); }
+
+	static bool load(const std::string& path, std::vector<FrameRecord>& records);
+
+private:
+	enum : unsigned int {
+		VERSION = 1,
+		RECORD_BYTES = 40,
+		RING = 1024, // 17 s of frames at 60 Hz before anything is dropped
+	};
+
+	EventRing<FrameRecord, RING> ring;
+	std::ofstream file;
+	bool csv = false;
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::atomic<unsigned long long> writtenCount{ 0 };
+
+	void run()
+	{
+		PROFILE_THREAD("telemetry");
+		std::vector<unsigned char> bytes;
+		for (;;) {
+			// one last drain after close() asked to stop
+			bool stopping = !running.load(std::memory_order_acquire);
+			unsigned long long rss = residentBytes();
+			unsigned long long drained = 0;
+			FrameRecord record;
+			bytes.clear();
+			while (ring.pop(record)) {
+				record.rssBytes = rss;
+				// straight into the file's buffer; a string per drain would allocate
+				if (csv)
+					file << record.frame << ',' << record.seconds << ',' << record.frameMs << ',' << record.simMs << ',' << record.gpuMs << ','
+						<< record.liveFoods << ',' << record.drawCalls << ',' << record.allocations << ',' << record.rssBytes / 1024 << '\n';
+				else
+					encode(record, bytes);
+				drained++;
+			}
+			if (drained) {
+				if (!csv)
+					file.write((const char*)bytes.data(), bytes.size());
+				file.flush();
+				writtenCount.fetch_add(drained, std::memory_order_relaxed);
+			}
+			if (stopping)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+	}
+
+	static void encode(const FrameRecord& r, std::vector<unsigned char>& bytes)
+	{
+		putLE(bytes, r.frame, 4);
+		putFloatLE(bytes, r.seconds);
+		putFloatLE(bytes, r.frameMs);
+		putFloatLE(bytes, r.simMs);
+		putFloatLE(bytes, r.gpuMs);
+		putLE(bytes, r.liveFoods, 4);
+		putLE(bytes, r.drawCalls, 4);
+		putLE(bytes, r.allocations, 4);
+		putLE(bytes, r.rssBytes, 8);
+	}
+};
+
+// reads either form back; a torn last record (the run was killed) is ignored
+inline bool TelemetryWriter::load(const std::string& path, std::vector<FrameRecord>& records)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file.is_open()) {
+		LOG_ERROR(TELEMETRY, "could not open %s", path.c_str());
+		return false;
+	}
+	records.clear();
+	if (bytes.size() >= 12 && bytes[0] == 'F' && bytes[1] == 'R' && bytes[2] == 'T' && bytes[3] == 'M') {
+		if (getLE(bytes, 4, 4) != VERSION || getLE(bytes, 8, 4) != RECORD_BYTES) {
+			LOG_ERROR(TELEMETRY, "%s has an unknown version", path.c_str());
+			return false;
+		}
+		for (size_t at = 12; at + RECORD_BYTES <= bytes.size(); at += RECORD_BYTES) {
+			FrameRecord r;
+			r.frame = (unsigned int)getLE(bytes, at, 4);
+			r.seconds = getFloatLE(bytes, at + 4);
+			r.frameMs = getFloatLE(bytes, at + 8);
+			r.simMs = getFloatLE(bytes, at + 12);
+			r.gpuMs = getFloatLE(bytes, at + 16);
+			r.liveFoods = (unsigned int)getLE(bytes, at + 20, 4);
+			r.drawCalls = (unsigned int)getLE(bytes, at + 24, 4);
+			r.allocations = (unsigned int)getLE(bytes, at + 28, 4);
+			r.rssBytes = getLE(bytes, at + 32, 8);
+			records.push_back(r);
+		}
+		return true;
+	}
+
+	std::istringstream text(std::string(bytes.begin(), bytes.end()));
+	std::string line;
+	if (!std::getline(text, line) || line.compare(0, 6, "frame,") != 0) {
+		LOG_ERROR(TELEMETRY, "%s is not a telemetry recording", path.c_str());
+		return false;
+	}
+	while (std::getline(text, line)) {
+		std::istringstream fields(line);
+		FrameRecord r;
+		char comma;
+		unsigned long long rssKb = 0;
+		if (fields >> r.frame >> comma >> r.seconds >> comma >> r.frameMs >> comma >> r.simMs >> comma >> r.gpuMs >> comma
+			>> r.liveFoods >> comma >> r.drawCalls >> comma >> r.allocations >> comma >> rssKb) {
+			r.rssBytes = rssKb * 1024;
+			records.push_back(r);
+		}
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,132 @@
+#ifndef TELEMETRY_ANALYSIS_H
+#define TELEMETRY_ANALYSIS_H
+
+#include "telemetry.h"
+#include "stats.h"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <iostream>
+
+// --analyze FILE [--baseline FILE]: percentiles of a telemetry recording,
+// trends that point at leaks, and, given a baseline recording, the metrics
+// that got slower. Returns 1 when anything was flagged, so soak scripts can
+// fail on it.
+struct TelemetryMetric {
+	const char* name;
+	float FrameRecord::* field;
+};
+
+static const TelemetryMetric telemetryTimings[] = {
+	{ "frame ms", &FrameRecord::frameMs },
+	{ "sim ms", &FrameRecord::simMs },
+	{ "gpu ms", &FrameRecord::gpuMs },
+};
+
+// least squares slope of value over seconds, per hour
+template <typename Value>
+inline double trendPerHour(const std::vector<FrameRecord>& records, size_t first, Value value)
+{
+	double n = 0, sumT = 0, sumV = 0, sumTT = 0, sumTV = 0;
+	for (size_t i = first; i < records.size(); i++) {
+		double t = records[i].seconds, v = value(records[i]);
+		n++;
+		sumT += t;
+		sumV += v;
+		sumTT += t * t;
+		sumTV += t * v;
+	}
+	double d = n * sumTT - sumT * sumT;
+	return n > 1 && d > 0.0 ? (n * sumTV - sumT * sumV) / d * 3600.0 : 0.0;
+}
+
+inline std::vector<double> telemetrySamples(const std::vector<FrameRecord>& records, float FrameRecord::* field)
+{
+	std::vector<double> samples;
+	samples.reserve(records.size());
+	for (size_t i = 0; i < records.size(); i++)
+		samples.push_back(records[i].*field);
+	return samples;
+}
+
+inline int runTelemetryAnalysis(const std::string& path, const std::string& baselinePath)
+{
+	std::vector<FrameRecord> records;
+	if (!TelemetryWriter::load(path, records))
+		return 1;
+	if (records.size() < 2) {
+		LOG_ERROR(TELEMETRY, "%s has fewer than two frames", path.c_str());
+		return 1;
+	}
+	float hours = (records.back().seconds - records.front().seconds) / 3600.0f;
+	std::cout << path << ": " << records.size() << " frames over " << hours * 60.0f << " minutes" << std::endl;
+
+	char line[128];
+	for (const TelemetryMetric& metric : telemetryTimings) {
+		std::vector<double> samples = telemetrySamples(records, metric.field);
+		snprintf(line, sizeof(line), "  %-9s p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f", metric.name,
+			percentile(samples, 50), percentile(samples, 95), percentile(samples, 99), percentile(samples, 100));
+		std::cout << line << std::endl;
+	}
+
+	// the first tenth is warm-up: caches, pools and the driver fill up there
+	bool flagged = false;
+	size_t steady = records.size() / 10;
+	double steadyHours = (records.back().seconds - records[steady].seconds) / 3600.0;
+	double rssPerHour = trendPerHour(records, steady, [](const FrameRecord& r) { return (double)r.rssBytes; });
+	double foodsPerHour = trendPerHour(records, steady, [](const FrameRecord& r) { return (double)r.liveFoods; });
+	double frameMsPerHour = trendPerHour(records, steady, [](const FrameRecord& r) { return (double)r.frameMs; });
+	double meanFoods = 0.0, meanFrameMs = 0.0, meanAllocations = 0.0;
+	for (size_t i = steady; i < records.size(); i++) {
+		meanFoods += records[i].liveFoods;
+		meanFrameMs += records[i].frameMs;
+		meanAllocations += records[i].allocations;
+	}
+	meanFoods /= records.size() - steady;
+	meanFrameMs /= records.size() - steady;
+	meanAllocations /= records.size() - steady;
+	snprintf(line, sizeof(line), "  trends    rss %+.2f MB/h  foods %+.1f/h  frame %+.3f ms/h  allocations %.1f/frame",
+		rssPerHour / (1024.0 * 1024.0), foodsPerHour, frameMsPerHour, meanAllocations);
+	std::cout << line << std::endl;
+
+	// growth over the steady part of the run, against thresholds loose enough for noisy machines
+	double rssGrowth = rssPerHour * steadyHours;
+	if (rssGrowth > 4.0 * 1024 * 1024 && rssGrowth > records[steady].rssBytes * 0.05) {
+		std::cout << "LEAK::RSS: grew " << rssGrowth / (1024.0 * 1024.0) << " MB after warm-up" << std::endl;
+		flagged = true;
+	}
+	if (foodsPerHour * steadyHours > meanFoods * 0.25 + 5.0) {
+		std::cout << "LEAK::FOODS: live foods keep growing, " << foodsPerHour * steadyHours << " over " << meanFoods << " on average" << std::endl;
+		flagged = true;
+	}
+	if (frameMsPerHour * steadyHours > meanFrameMs * 0.25 + 0.5) {
+		std::cout << "LEAK::FRAME: frames got " << frameMsPerHour * steadyHours << " ms slower over the run" << std::endl;
+		flagged = true;
+	}
+
+	if (!baselinePath.empty()) {
+		std::vector<FrameRecord> baseline;
+		if (!TelemetryWriter::load(baselinePath, baseline) || baseline.empty())
+			return 1;
+		std::cout << "against " << baselinePath << " (" << baseline.size() << " frames):" << std::endl;
+		for (const TelemetryMetric& metric : telemetryTimings) {
+			std::vector<double> now = telemetrySamples(records, metric.field);
+			std::vector<double> before = telemetrySamples(baseline, metric.field);
+			const double ps[] = { 50, 95, 99 };
+			for (double p : ps) {
+				double a = percentile(before, p), b = percentile(now, p);
+				// 10% and 0.1 ms both, so tiny timings do not trip it on jitter alone
+				bool slower = b > a * 1.10 && b - a > 0.1;
+				snprintf(line, sizeof(line), "  %-9s p%-2.0f %7.3f -> %7.3f  %+6.1f%%%s", metric.name, p, a, b,
+					a > 0.0 ? (b - a) / a * 100.0 : 0.0, slower ? "  REGRESSION" : "");
+				std::cout << line << std::endl;
+				flagged = flagged || slower;
+			}
+		}
+	}
+
+	std::cout << (flagged ? "Telemetry check FAILED" : "Telemetry check passed") << std::endl;
+	return flagged ? 1 : 0;
+}
+#endif
@@ -0,0 +1,49 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Lock-free single producer / single consumer handoff of the latest value.
+// The writer fills back() and publishes it; the reader always gets the newest
+// published value. Neither side ever waits: a value the reader did not get to
+// in time is simply overwritten by the next one. Three slots are enough
+// because at any moment one belongs to the writer, one to the reader, and the
+// third sits in the middle, swapped in and out with a single atomic exchange.
+template <typename T>
+class TripleBuffer
+{
+public:
+	// writer side: the slot to fill next
+	T& back() { return slots[backIndex]; }
+
+	// writer side: hands back() to the reader and takes the middle slot in exchange
+	void publish()
+	{
+		int previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+		backIndex = previous & INDEX;
+	}
+
+	// reader side: newest published value, or the one from last time when nothing new arrived
+	const T& consume(bool* fresh = nullptr)
+	{
+		bool isFresh = (middle.load(std::memory_order_relaxed) & FRESH) != 0;
+		if (isFresh) {
+			int previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+			frontIndex = previous & INDEX;
+		}
+		if (fresh)
+			*fresh = isFresh;
+		return slots[frontIndex];
+	}
+
+private:
+	static const int INDEX = 3;
+	static const int FRESH = 4;
+
+	T slots[3];
+	// the two sides hammer different cache lines
+	alignas(64) std::atomic<int> middle{ 1 };
+	alignas(64) int backIndex = 0;
+	alignas(64) int frontIndex = 2;
+};
+#endif
@@ -0,0 +1,81 @@
+#ifndef TUNNELING_H
+#define TUNNELING_H
+
+#include "game.h"
+
+#include <iostream>
+
+// --check-tunneling: drops foods straight onto the plate, and slides the plate
+// through hovering foods, at speeds and tick rates well past what the game
+// reaches. With the swept test every single one must be collected, however far
+// it moves in a tick. Returns the exit code.
+inline int runTunnelingCheck()
+{
+	const int tickRates[] = { 240, 120, 60, 30, 15, 10 };
+	const float foodSpeeds[] = { 0.42f, 1.5f, 4.0f, 10.0f, 25.0f };
+	const float plateSpeeds[] = { 1.8f, 5.0f, 9.0f };
+	const int drops = 20;
+	int missed = 0;
+
+	for (int r = 0; r < 6; r++) {
+		float dt = 1.0f / tickRates[r];
+
+		// falling foods, the plate standing still under them
+		for (int s = 0; s < 5; s++) {
+			Game game;
+			game.delay = 1e9f;
+			game.increaseDifficulty = 1e9f;
+			game.foodSpeed = foodSpeeds[s];
+			game.broadphase.remove(game.foods.handle(0));
+			game.foods.remove(0);
+			GameInput still;
+			for (int d = 0; d < drops; d++) {
+				// a different phase each drop, so the plate is met at every point of a tick
+				game.drop(glm::vec3(game.platePosition.x, 1.20f - 0.0137f * d, 0.0f), d % 3);
+				while (game.foods.size() > 0)
+					game.tick(dt, still);
+			}
+			int lost = drops - game.numberOfCollisions;
+			missed += lost;
+			std::cout << tickRates[r] << " Hz, food " << foodSpeeds[s] << "/s: " << game.numberOfCollisions << " of " << drops << " collected"
+				<< (lost ? "  TUNNELED" : "") << std::endl;
+		}
+
+		// the plate sliding across foods held at its height
+		for (int s = 0; s < 3; s++) {
+			Game game;
+			game.delay = 1e9f;
+			game.increaseDifficulty = 1e9f;
+			game.foodSpeed = 0.0f;
+			game.plateSpeed = plateSpeeds[s];
+			game.broadphase.remove(game.foods.handle(0));
+			game.foods.remove(0);
+			for (int d = 0; d < drops; d++) {
+				// park at one end, then run to the other through a food in the middle lane
+				GameInput move;
+				move.plateDirection = d % 2 ? -1 : 1;
+				GameInput back;
+				back.plateDirection = -move.plateDirection;
+				while (game.platePosition.x * move.plateDirection > -0.45f)
+					game.tick(dt, back);
+				// above the height where foods retire, inside the plate box
+				game.drop(glm::vec3(0.0f, game.platePosition.y + 0.05f, 0.0f), d % 3);
+				for (int t = 0; t < tickRates[r] && game.foods.size() > 0; t++)
+					game.tick(dt, move);
+				// a food the plate missed hangs there; take it away
+				for (unsigned int i = game.foods.size(); i > 0; i--) {
+					game.broadphase.remove(game.foods.handle(i - 1));
+					game.foods.remove(i - 1);
+				}
+			}
+			int lost = drops - game.numberOfCollisions;
+			missed += lost;
+			std::cout << tickRates[r] << " Hz, plate " << plateSpeeds[s] << "/s: " << game.numberOfCollisions << " of " << drops << " collected"
+				<< (lost ? "  TUNNELED" : "") << std::endl;
+		}
+	}
+
+	std::cout << (missed ? "Tunneling check FAILED: " : "Tunneling check passed: ") << missed << " foods missed" << std::endl;
+	return missed ? 1 : 0;
+}
+#endif
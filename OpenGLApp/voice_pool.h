@@ -0,0 +1,193 @@
+#ifndef VOICE_POOL_H
+#define VOICE_POOL_H
+
+#include "sound_bank.h"
+#include "logging.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+
+// What VoicePool plays through. Voices are numbered 0..voices-1 by the pool;
+// a backend only has to start, stop and poll them.
+class AudioBackend {
+public:
+	virtual ~AudioBackend() {}
+	// once per loaded sound, before anything plays
+	virtual bool upload(unsigned short id, const SoundClip& clip) = 0;
+	// gain 0..1, pan -1 (left) .. 1 (right)
+	virtual void start(unsigned int voice, unsigned short id, float gain, float pan) = 0;
+	virtual void stop(unsigned int voice) = 0;
+	virtual bool finished(unsigned int voice) = 0;
+};
+
+// Plays nothing, but keeps every voice busy for the length of its clip, so the
+// pool behaves as it would on a sound card. With a log open it also writes one
+// line per start and stop:
+//
+//   seconds voice start sound gain pan
+//   seconds voice stop
+//
+// The clock is real time unless advance() is used, which switches it to a
+// manual one for repeatable tests.
+class NullAudioBackend : public AudioBackend {
+public:
+	NullAudioBackend() : origin(std::chrono::steady_clock::now()) {}
+
+	bool openLog(const std::string& path)
+	{
+		log.open(path);
+		if (!log) {
+			LOG_ERROR(SOUND, "could not write %s", path.c_str());
+			return false;
+		}
+		log << std::fixed << std::setprecision(3);
+		return true;
+	}
+
+	void advance(double seconds)
+	{
+		manualClock = true;
+		time += seconds;
+	}
+
+	bool upload(unsigned short id, const SoundClip& clip) override
+	{
+		if (id >= SOUND_COUNT)
+			return false;
+		lengths[id] = clip.seconds();
+		return true;
+	}
+
+	void start(unsigned int voice, unsigned short id, float gain, float pan) override
+	{
+		if (voice >= ends.size())
+			ends.resize(voice + 1, 0.0);
+		ends[voice] = now() + lengths[id];
+		if (log.is_open())
+			log << now() << " " << voice << " start " << id << " " << gain << " " << pan << "\n";
+	}
+
+	void stop(unsigned int voice) override
+	{
+		if (voice < ends.size())
+			ends[voice] = 0.0;
+		if (log.is_open())
+			log << now() << " " << voice << " stop\n";
+	}
+
+	bool finished(unsigned int voice) override
+	{
+		return voice >= ends.size() || now() >= ends[voice];
+	}
+
+private:
+	std::chrono::steady_clock::time_point origin;
+	bool manualClock = false;
+	double time = 0.0;
+	float lengths[SOUND_COUNT] = {};
+	std::vector<double> ends;
+	std::ofstream log;
+
+	double now() const
+	{
+		if (manualClock)
+			return time;
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+	}
+};
+
+// A fixed number of voices shared by all sounds. A new sound takes a free
+// voice; when none is free it steals the one playing the lowest priority
+// sound, the oldest of those on a tie, as long as that priority is not above
+// its own. Otherwise the new sound is not played. Audio thread only.
+class VoicePool {
+public:
+	VoicePool(AudioBackend& backend, const SoundBank& bank, unsigned int voices = 8)
+		: backend(backend), bank(bank), voices(voices)
+	{
+	}
+
+	// true when the event got a voice
+	bool play(const SoundEvent& event)
+	{
+		if (!bank.loaded(event.id)) {
+			rejectedCount++;
+			return false;
+		}
+		int priority = bank.priority(event.id);
+		const unsigned int none = (unsigned int)voices.size();
+		unsigned int chosen = none;
+		for (unsigned int v = 0; v < voices.size(); v++) {
+			if (voices[v].active && backend.finished(v))
+				voices[v].active = false;
+			if (!voices[v].active) {
+				chosen = v;
+				break;
+			}
+			if (chosen == none || voices[v].priority < voices[chosen].priority
+				|| (voices[v].priority == voices[chosen].priority && voices[v].started < voices[chosen].started))
+				chosen = v;
+		}
+		if (chosen == none) {
+			rejectedCount++;
+			return false;
+		}
+		Voice& voice = voices[chosen];
+		if (voice.active) {
+			if (voice.priority > priority) {
+				rejectedCount++;
+				return false;
+			}
+			backend.stop(chosen);
+			stolenCount++;
+		}
+		// the belt spans about -0.5 .. 0.5 in x
+		float pan = std::max(-1.0f, std::min(1.0f, event.position.x * 2.0f));
+		backend.start(chosen, event.id, event.gain, pan);
+		voice.active = true;
+		voice.priority = priority;
+		voice.started = ++sequence;
+		playedCount++;
+		return true;
+	}
+
+	void stopAll()
+	{
+		for (unsigned int v = 0; v < voices.size(); v++) {
+			if (voices[v].active)
+				backend.stop(v);
+			voices[v].active = false;
+		}
+	}
+
+	unsigned int size() const { return (unsigned int)voices.size(); }
+	unsigned int busy()
+	{
+		unsigned int count = 0;
+		for (unsigned int v = 0; v < voices.size(); v++)
+			count += voices[v].active && !backend.finished(v);
+		return count;
+	}
+	unsigned int played() const { return playedCount; }
+	unsigned int stolen() const { return stolenCount; }
+	unsigned int rejected() const { return rejectedCount; }
+
+private:
+	struct Voice {
+		bool active = false;
+		int priority = 0;
+		unsigned long long started = 0;
+	};
+
+	AudioBackend& backend;
+	const SoundBank& bank;
+	std::vector<Voice> voices;
+	unsigned long long sequence = 0;
+	unsigned int playedCount = 0, stolenCount = 0, rejectedCount = 0;
+};
+#endif